@@ -11,41 +11,52 @@
 /*********************************************************************************/
 #include "Control_ECU.h"
 #include "external_eeprom.h"
+#include "credential.h"
+#include "user_table.h"
 #include "motor.h"
+#include "door.h"
 #include "buzzer.h"
 #include "timer.h"
 #include "twi.h"
 #include "uart.h"
+#include "protocol.h"
+#include "sw_timer.h"
+#include "power.h"
 #include <avr/io.h> /* to enable the global interrupt*/
-#include "util/delay.h"
 /*******************************************************************************
  *                                global variables                                  *
  *******************************************************************************/
-/* flag to know when the timer finish counting*/
-uint8 timer_tick=0;
-
 /* to know how many times the user entered wrong password*/
 uint8 WrongPasswordCounts = 0;
 
+/* the EEPROM log which keeps the wrong password counter after a reset */
+EEPROM_LogType g_attemptsLog;
+
 
 /*******************************************************************************
  *                              Functions Definitions                           *
  *******************************************************************************/
 
 /*
- * Description : This function recive the password byte by byte from HMIECU and save it into buffer
+ * Description : This function recive the credential frame (the whole password) from HMIECU and save it into buffer
  */
 void receivePassword(uint8* password)
 {
-	/* Wait until HMI ECU reply that it is ready to start communication */
-	while(UART_recieveByte()!= HMI_ECU_READY);
+	Protocol_FrameType frame;
 
-	 /* Send dummy byte to tell HMIECU that Control ECU is ready */
-	UART_sendByte(CONTROL_ECU_READY);
+	/* Wait for a valid credential frame, the link probes of a reset HMI ECU are answered, any other frame is dropped */
+	do
+	{
+		PROTOCOL_receiveFrame(&frame);
+		if(frame.type == PROTOCOL_MSG_LINK_PROBE)
+		{
+			handleLinkProbe();
+		}
+	}while((frame.type != PROTOCOL_MSG_CREDENTIAL) || (frame.length != PASSWORD_LENGTH));
 
-	/* Save the password which is recieved by UART Protocol byte by byte */
+	/* Save the password which is recieved in the frame payload */
 	for(uint8 i = 0;i < PASSWORD_LENGTH;i++){
-		password[i] = UART_recieveByte();
+		password[i] = frame.payload[i];
 	}
 }
 /*****************************************************************************************/
@@ -64,16 +75,27 @@ uint8 match_passwords(const uint8* first_password,const uint8* second_password){
 		return TRUE;
 }
 
+/***********************************************************************************************/
+/*
+ * Description : This Function updates the wrong password counter and appends it in the EEPROM log
+ * (only if it changed) so a reset can't clear the counter before the alarm
+ */
+void setWrongPasswordCounts(uint8 count){
+	if(count != WrongPasswordCounts)
+	{
+		WrongPasswordCounts = count;
+		EEPROM_logAppend(&g_attemptsLog,&WrongPasswordCounts,1);
+	}
+}
+
 /***********************************************************************************************/
 /*
  * Description : This Function saves the correct password in External EEPROM
+ * and returns the EEPROM status (SUCCESS once the password is really stored)
 */
-void Save_Password_in_EEPROM(const uint8* password){
-	for(uint8 i=0;i<PASSWORD_LENGTH;i++)
-		{
-			/* Write Every digit of password in the external EEPROM */
-			EEPROM_writeByte( (PASSWORD_LOCATION) + i, password[i]);
-		}
+uint8 Save_Password_in_EEPROM(const uint8* password){
+	/* Write the password in the older A/B slot of the external EEPROM then update the SRAM copy */
+	return Credential_store(password);
 }
 
 /*************************************************************************************************/
@@ -90,11 +112,10 @@ uint8 AdjustPassword_FirstTime(uint8* first_password,uint8* second_password)
 	/* Receive the Second password from HMIECU */
 	receivePassword(second_password);
 
-	/* Save the password in External EEPROM if the 2 Passwords are matched */
+	/* Save the password in External EEPROM if the 2 Passwords are matched , a failed write is reported as an error */
 	if(match_passwords(first_password,second_password))
 	{
-		Save_Password_in_EEPROM(first_password);
-		return SUCCESS;
+		return (Save_Password_in_EEPROM(first_password) == SUCCESS) ? SUCCESS : ERROR;
 	}
 	else
 	{
@@ -102,178 +123,275 @@ uint8 AdjustPassword_FirstTime(uint8* first_password,uint8* second_password)
 	}
 }
 
-/*******************************************************************************************/
+/*****************************************************************************************/
+/*
+ * Description : it will handle the option frame sent by HMI ECU (Open door - Change Password - Extend - Cancel)
+ */
+void handleOption(uint8 option,uint8* password,uint8* EEPROM_password)
+{
+	if(option == OPEN_DOOR_OPTION)
+	{
+		/* a second request while the door is moving is refused so the HMI ECU doesn't wait for nothing */
+		if(Door_isBusy())
+		{
+			send_status_to_HMIECU(DOOR_IS_BUSY);
+		}
+		else
+		{
+			/* the wrong password counter is only reset by a correct password or after the alarm */
+			handelOpenDoorOption(password);
+		}
+	}
+	else if(option == CHANGE_PASSWORD_OPTION)
+	{
+		if(Door_isBusy())
+		{
+			send_status_to_HMIECU(DOOR_IS_BUSY);
+		}
+		else
+		{
+			handleChangePasswordOption(password,EEPROM_password);
+		}
+	}
+	else if(option == DOOR_EXTEND_OPTION)
+	{
+		Door_extendHold(DOOR_EXTEND_TIME_MS);
+	}
+	else if(option == DOOR_CANCEL_OPTION)
+	{
+		Door_cancelCycle();
+	}
+}
 
+/*****************************************************************************************/
 /*
- * Description : this function tells the timer to start counting with specific configuration
- * and give it how many interrupts you want
+ * Description : it will handle the admin frame (add - revoke a staff code) and answer with its status
  */
-void delayWithTimer(Timer_ConfigType* timer_config,uint8 interrupt_number)
+void handleAdminMessage(const Protocol_FrameType* frame)
 {
-	/*set Timer Configuration*/
-	Timer_init(timer_config);
+	const uint8* payload = frame->payload;
+	UserTable_UserType user;
+	uint8 status = ERROR;
+
+	/* the command, then the master password which must match the saved one */
+	if(frame->length < ADMIN_REVOKE_LENGTH)
+	{
+		/* not an admin message, no password to check */
+	}
+	else if(!Credential_match(&payload[1]))
+	{
+		/* a wrong master password counts like a wrong password from the keypad (same counter and log) */
+		setWrongPasswordCounts(WrongPasswordCounts + 1);
+	}
+	else
+	{
+		setWrongPasswordCounts(0);
 
-	/* waiting until the timer count reaches the specified no_of_interrupts */
-	while(timer_tick < interrupt_number);
+		if((payload[0] == ADMIN_ADD_USER) && (frame->length == ADMIN_ADD_LENGTH))
+		{
+			payload += 1 + PASSWORD_LENGTH;
+			user.id = payload[0];
+			user.flags = payload[1 + USER_TABLE_CODE_LENGTH];
+			status = UserTable_add(&user,&frame->payload[2 + PASSWORD_LENGTH]);
+		}
+		else if((payload[0] == ADMIN_REVOKE_USER) && (frame->length == ADMIN_REVOKE_LENGTH))
+		{
+			status = UserTable_revoke(payload[1 + PASSWORD_LENGTH]);
+		}
+	}
 
-	/* Stop The Timer*/
-	Timer_DeInit(timer_config->Timer_ID);
+	PROTOCOL_sendFrame(PROTOCOL_MSG_ADMIN,&status,1);
 
-	/*reset number of ticks*/
-	timer_tick = 0;
+	/* too many wrong passwords, the admin frames are refused until the alarm is over */
+	if(WrongPasswordCounts >= MAX_WRONG_PASSWORDS)
+	{
+		runLockout(FALSE);
+	}
 }
 
 /*****************************************************************************************/
 /*
- * Description : it will get the option from user (Open door - Change Password)
+ * Description : it will answer the diagnostic request with the power and link statistics
  */
-uint8 getOption_From_HMIECU(void)
+void handleDiagMessage(const Protocol_FrameType* frame)
 {
-	/* Wait until HMI ECU reply that it is ready to receive  */
-	while(UART_recieveByte()!= HMI_ECU_READY);
+	uint8 answer[DIAG_ANSWER_LENGTH];
+	uint16 permille;
+	uint32 current;
+	uint16 overflow;
 
-	/* Send dummy byte to tell HMIECU that ControlECU is ready to start communication */
-	UART_sendByte(CONTROL_ECU_READY);
+	/* the request has no payload, the answer frames of the other side are ignored */
+	if(frame->length != 0)
+	{
+		return;
+	}
 
-	return UART_recieveByte();
+	/* the divisions are done here only, not in the idle path */
+	permille = Power_getIdlePermille();
+	current = Power_estimateCurrentUa();
+	overflow = UART_getRxOverflowCount();
+
+	answer[0] = (uint8)permille;
+	answer[1] = (uint8)(permille >> 8);
+	answer[2] = (uint8)current;
+	answer[3] = (uint8)(current >> 8);
+	answer[4] = (uint8)(current >> 16);
+	answer[5] = (uint8)(current >> 24);
+	answer[6] = (uint8)overflow;
+	answer[7] = (uint8)(overflow >> 8);
+
+	PROTOCOL_sendFrame(PROTOCOL_MSG_DIAG,answer,DIAG_ANSWER_LENGTH);
 }
 
 /*****************************************************************************************/
 /*
- * Description : This function send status to HMI ECU (DOOR_IS_OPENING - DOOR_IS_CLOSING - DOOR_IS_CLOSED)
+ * Description : This function runs the alarm for LOCKOUT_TIME_MS after too many wrong passwords (keypad or admin tool),
+ * the door cycle keeps running and the frames received meanwhile are handled here:
+ * the admin frames are refused (ERROR), an open door or change password option is answered with ERROR_MESSAGE,
+ * then HMI ECU is told to continue the program at the end if it is waiting (hmi_waiting or a refused option)
  */
-void send_status_to_HMIECU(uint8 state){
+void runLockout(boolean hmi_waiting)
+{
+	Protocol_FrameType frame;
+	uint8 status = ERROR;
+	uint32 deadline = Clock_nowMs() + LOCKOUT_TIME_MS;
 
-	/* Send dummy byte to tell HMIECU that ControlECU is ready to start communication */
-	UART_sendByte(CONTROL_ECU_READY);
+	/*START the alarm*/
+	Buzzer_on();
 
-	/* Wait until HMI ECU reply that it is ready to receive  */
-	while(UART_recieveByte()!= HMI_ECU_READY);
+	do
+	{
+		if(PROTOCOL_pollFrame(&frame))
+		{
+			if(frame.type == PROTOCOL_MSG_ADMIN)
+			{
+				PROTOCOL_sendFrame(PROTOCOL_MSG_ADMIN,&status,1);
+			}
+			else if((frame.type == PROTOCOL_MSG_OPTION) && (frame.length == 1))
+			{
+				if((frame.payload[0] == OPEN_DOOR_OPTION) || (frame.payload[0] == CHANGE_PASSWORD_OPTION))
+				{
+					send_status_to_HMIECU(ERROR_MESSAGE);
+					hmi_waiting = TRUE;
+				}
+				else
+				{
+					/* extend - cancel the door cycle, they don't need a password */
+					handleOption(frame.payload[0],NULL_PTR,NULL_PTR);
+				}
+			}
+			else if(frame.type == PROTOCOL_MSG_LINK_PROBE)
+			{
+				handleLinkProbe();
+			}
+		}
 
-	UART_sendByte(state);
-}
+		SwTimer_process();
+		Power_idle();
+	}while(!CLOCK_IS_REACHED(Clock_nowMs(),deadline));
 
-/*************************************************************************************************/
+	/*stop the alarm*/
+	Buzzer_off();
+
+	/*reset the counter once the alarm is over (a reset during the alarm keeps it)*/
+	setWrongPasswordCounts(0);
 
+	/*tell HMI ECU to display the main menu again*/
+	if(hmi_waiting)
+	{
+		send_status_to_HMIECU(CONTINUE_PROGRAM);
+	}
+}
+
+/*****************************************************************************************/
 /*
- * Description : This function read the saved paswword from External EERROM
-*/
-void read_Password_in_EEPROM(uint8* password)
+ * Description : This Function checks if the password is the code of a staff user allowed to open the door,
+ * it doesn't read the EEPROM while there is no staff user (see UserTable_count)
+ */
+boolean isStaffCodeAllowed(const uint8* password)
 {
-	for(uint8 i = 0; i < PASSWORD_LENGTH;i++)
+	UserTable_UserType user;
+
+	if(UserTable_find(password,&user) != SUCCESS)
 	{
-		EEPROM_readByte(PASSWORD_LOCATION  + i,password+i);
+		return FALSE;
 	}
+
+	return UserTable_isAllowed(&user,USER_FLAG_OPEN_DOOR);
 }
 
-/**************************************************************************************/
+/*****************************************************************************************/
+/*
+ * Description : This function send status to HMI ECU (DOOR_IS_OPENING - DOOR_IS_CLOSING - DOOR_IS_CLOSED)
+ */
+void send_status_to_HMIECU(uint8 state){
+
+	/* Send the status in one frame */
+	PROTOCOL_sendFrame(PROTOCOL_MSG_STATUS,&state,1);
+}
+
+/*************************************************************************************************/
+
+/*
+ * Description : This function answers a link probe of the HMI ECU (it was reset alone) at the baud rate
+ * the probe arrived on, then sends the provisioning state again as the HMI ECU waits for it after its probe
+ */
+void handleLinkProbe(void){
+	PROTOCOL_answerLinkProbe();
+	send_provisioning_state_to_HMIECU(Credential_isProvisioned() ? DEVICE_PROVISIONED : DEVICE_NOT_PROVISIONED);
+}
+
+/*************************************************************************************************/
+
+/*
+ * Description : This function sends the provisioning state to HMI ECU at boot (DEVICE_PROVISIONED - DEVICE_NOT_PROVISIONED)
+ */
+void send_provisioning_state_to_HMIECU(uint8 state){
+
+	/* Send the state in one frame */
+	PROTOCOL_sendFrame(PROTOCOL_MSG_PROVISIONING,&state,1);
+}
 
 /*
  * Description : This function is to handle open the door request ,
  * It takes Password From HMI_ECU Then:
- * Compares this password with the one saved in EEPROM , if the 2 passwords matches:
- * it will open the door for 15 seconds and send the status for HMI ECU (Door is Opening) to display it on LCD.
+ * Compares this password with the one saved in EEPROM (its SRAM copy) , if the 2 passwords matches:
+ * it will start the door cycle (see door.c) which sends the status for HMI ECU (Door is Opening) to display it on LCD.
  * if the user entered wrong password for three times:
  * the control ECU will Turn on buzzer alarm for 1 minute, send the status for HMI ECU (Error) ,
  * then  control ECU informs the HMI ECU  to continue the program After 1 minute.
 */
-void handelOpenDoorOption(uint8* password,uint8* EEPROM_password)
+void handelOpenDoorOption(uint8* password)
 {
 	while(1){
-		/*	TIMER1 configuration
-		 * 1) F_CPU = 8Mhz  , Used prescaler for Timer1 = 1024 to get less no.of.interrupts
-		 * 2) F_Timer1 = 8M/1024 ~ 7813hz => T_Count = 1/7813 = (128sec)
-		 * 3) We will get the 15 seconds in 2 interrupts.
-		 * 		      1(count) --> (128sec)    /  (62500 count)  ----> (8 sec)
-		 * 4) the compare value = 62500
-		*/
-
-		Timer_ConfigType Timer1_config = {Timer1,Compare_mode,F_CPU_1024,0,0,62500};
-
 		/* receive the password from the HMI ECU */
 		receivePassword(password);
 
-		/*get the password saved in EEPROM*/
-		read_Password_in_EEPROM(EEPROM_password);
-
-		/*check the two password*/
-		if(match_passwords(password,EEPROM_password) == TRUE)
+		/*check the password with the saved one (SRAM copy, no EEPROM access) then with the staff codes*/
+		if(Credential_match(password) || isStaffCodeAllowed(password))
 		{
-			/*if they match open the door and send the status to inform the HMI ECU*/
-			send_status_to_HMIECU(DOOR_IS_OPENING);
-
-			/* Dc motor will rotates for 15 seconds to open the door */
-			DcMotor_Rotate(CW,100);
-
-			/*start counting 15 seconds*/
-			delayWithTimer(&Timer1_config,2);
-
-			/*after 15 seconds the motor will stop for 3 seconds*/
-			DcMotor_Rotate(STOP,0);
-
-			/* TIMER1 configuration */
 			/*
-			 * 1) F_CPU = 8Mhz Used prescaler for Timer1 = 1024 to get less no.of.interrupts
-			 * 2) F_Timer1 = 8M/1024 ~ 7813hz => T_Count = 1/7813 = (128sec)
-			 * 3) We will get the 3 seconds in 1 interrupt.
-			 *   1(count) --> (128sec)    /  (23438 count)  ----> (3 sec)
-			 * 4) the compare value = 23438
+			 * if they match start the door cycle and return to the main loop,
+			 * the door state call back informs the HMI ECU (opening - closing - closed)
 			 */
-			Timer_ConfigType Timer1_config_three_seconds = {Timer1,Compare_mode,F_CPU_1024,0,23438};
-
-			/* wait 3 sconds*/
-			delayWithTimer(&Timer1_config_three_seconds,1);
-
-			/* send status to HMIECU to inform it that the door is closing*/
-			send_status_to_HMIECU(DOOR_IS_CLOSING);
-
-			/*  Dc motor will rotates Anti-Clockwise for 15 seconds to close the door*/
-			DcMotor_Rotate(A_CW,100);
-
-			delayWithTimer(&Timer1_config,2);
-
-			DcMotor_Rotate(STOP,0);
-
-			/* to let HMI ECU knows to stop displaying DOOR_IS_CLOSING */
-			send_status_to_HMIECU(DOOR_IS_CLOSED);
+			setWrongPasswordCounts(0);
+			Door_startCycle();
 			break;
 		}
 		else
 		{
-			WrongPasswordCounts++;
-			if(WrongPasswordCounts < 3)
+			setWrongPasswordCounts(WrongPasswordCounts + 1);
+			if(WrongPasswordCounts < MAX_WRONG_PASSWORDS)
 			{
 				send_status_to_HMIECU(PASSWORD_DISMATCH);
 			}
 			else
 			{
-				/*reset the counter to be able to use it again*/
-				WrongPasswordCounts = 0;
-
 				/*tell HMI ECU to display error message*/
 				send_status_to_HMIECU(ERROR_MESSAGE);
 
-				/*START the alarm*/
-				Buzzer_on();
-
-				/*setup the TIMER1 configuration */
-				/*
-				 * 1) F_CPU = 8Mhz Used prescaler for Timer1 = 1024 to get less no.of.interrupts
-				 * 2) F_Timer1 = 8M/1024 ~ 7813hz => T_Count = 1/7813 = (128sec)
-				 * 3) to count 60 seconds we need 8 interrupts.
-				 * 		1(count) --> (128sec)    /  (65535 count)  ----> (8 sec)
-				 * 4) we will work with timer 1 overflow mode
-				 */
-				Timer_ConfigType s_timer1_config = {Timer1,NormalMode,F_CPU_1024,0,0};
-
-				/* waiting 1 minute using timer 1*/
-				delayWithTimer(&s_timer1_config,7);
-
-				/*stop the alarm*/
-				Buzzer_off();
-
-				/*tell HMI ECU to display the main menu again*/
-				send_status_to_HMIECU(CONTINUE_PROGRAM);
+				/* 1 minute alarm, then HMI ECU is told to display the main menu again */
+				runLockout(TRUE);
 				break;
 			}
 		}
@@ -293,11 +411,8 @@ void handleChangePasswordOption(uint8* password,uint8* EEPROM_password){
 		/* receive the password from the HMI ECU */
 		receivePassword(password);
 
-		/*get the password saved in EEPROM*/
-		read_Password_in_EEPROM(EEPROM_password);
-
-		/* check the two password*/
-		if(match_passwords(password,EEPROM_password) == TRUE)
+		/* check the password with the saved one (SRAM copy, no EEPROM access)*/
+		if(Credential_match(password))
 		{
 			/* if they match change the password in EEPROM and send the status to inform the HMIECU*/
 			send_status_to_HMIECU(PASSWORD_MATCH);
@@ -316,45 +431,24 @@ void handleChangePasswordOption(uint8* password,uint8* EEPROM_password){
 				}
 			}
 
-			WrongPasswordCounts = 0;
+			setWrongPasswordCounts(0);
 			break;
 		}
 
 		else
 		{
-			WrongPasswordCounts++;
-			if(WrongPasswordCounts < 3)
+			setWrongPasswordCounts(WrongPasswordCounts + 1);
+			if(WrongPasswordCounts < MAX_WRONG_PASSWORDS)
 			{
 				send_status_to_HMIECU(PASSWORD_DISMATCH);
 			}
 			else
 			{
-				/*reset the wrong password counter */
-				WrongPasswordCounts = 0;
-
 				/*tell HMI ECU to display error message*/
 				send_status_to_HMIECU(ERROR_MESSAGE);
 
-				/* START the alarm*/
-				Buzzer_on();
-				/* TIMER1 configuration */
-				/*
-				 * 1) F_CPU = 8Mhz i used prescaler = 1024
-				 * 2) F_Timer1 = 8M/1024 ~ 7813hz => T_Count = 1/7813 = (128sec)
-				 * 3) to count 60 seconds we need 8 interrupts.
-				 * 		1(count) --> (128sec)    /  (65535 count)  ----> (8 sec)
-				 * 4) We will work with timer 1 overflow mode
-				 */
-				Timer_ConfigType s_timer1_config = {Timer1,NormalMode,F_CPU_1024,0,0};
-
-				/*waiting 1 minute using timer 1*/
-				delayWithTimer(&s_timer1_config,8);
-
-				/*stop the alarm*/
-				Buzzer_off();
-
-				/*tell HMI ECU to display the main menu again*/
-				send_status_to_HMIECU(CONTINUE_PROGRAM);
+				/* 1 minute alarm, then HMI ECU is told to display the main menu again */
+				runLockout(TRUE);
 				break;
 		}
 	}
@@ -363,13 +457,31 @@ void handleChangePasswordOption(uint8* password,uint8* EEPROM_password){
 /************************************************************************************************/
 
 /*
- * Description : this is a call back function contains a global variable which increases Every ISR Execution
+ * Description : this is the door state call back function, it informs the HMI ECU about the door state
  */
-void handelTimer(void){
-	timer_tick++;
+void handleDoorState(Door_StateType state)
+{
+	switch(state)
+	{
+		case DOOR_OPENING:
+			send_status_to_HMIECU(DOOR_IS_OPENING);
+			break;
+
+		case DOOR_CLOSING:
+			send_status_to_HMIECU(DOOR_IS_CLOSING);
+			break;
+
+		case DOOR_CLOSED:
+			/* to let HMI ECU knows to stop displaying DOOR_IS_CLOSING */
+			send_status_to_HMIECU(DOOR_IS_CLOSED);
+			break;
+
+		default:
+			break;
+	}
 }
 
-/*******************************************************************************************/
+/************************************************************************************************/
 
 /*******************************************************************************
  *                             Main Function                                   *
@@ -381,17 +493,14 @@ int main(void){
 	/*to hold the second_password taken from the user*/
 	uint8 second_password[PASSWORD_LENGTH];
 
-	/*to hold the selected option from HMI ECU*/
-	uint8 selected_option;
+	/*to hold the frames received from HMI ECU*/
+	Protocol_FrameType frame;
 
 	/* UART configuration*/
-	UART_ConfigType s_uart_config = {Eight_bits,Disabled,one_bit,Double_Speed_mode,UART_BAUD_RATE};
+	UART_ConfigType s_uart_config = {Eight_bits,Disabled,one_bit,Double_Speed_mode,UART_LINK_UBRR};
 
 	/* I2C configuration*/
-	TWI_ConfigType s_twi_config = {100000,CONTROL_ECU_ADDRESS};
-
-	/*setting the callback function*/
-	Timer1_setCallBack(handelTimer);
+	TWI_ConfigType s_twi_config = {TWI_BIT_RATE,CONTROL_ECU_ADDRESS};
 
 	/* 	calling the init functions for each driver */
 
@@ -408,11 +517,48 @@ int main(void){
 	/* initialise the motor external driver*/
 	DcMotor_Init();
 
+	/* start the 1ms system tick of the software timers */
+	SwTimer_init();
+
+	/* start measuring the idle time */
+	Power_init();
+
+	/* initialise the door state machine */
+	Door_setCallBack(handleDoorState);
+	Door_init();
+
 	/*set the I-bit to be able to use the timer driver*/
 	SREG |= (1<<7);
 
-	/* this loop keeps taking inputs until two matches */
-	while(1){
+	/* agree with HMI ECU on the link baud rate */
+	PROTOCOL_linkAnswer();
+
+	/* load the saved password once in SRAM, all the checks are done on this copy */
+	Credential_init();
+
+	/* count the staff users once, the staff lookup is skipped while there is none */
+	UserTable_init();
+
+	/* restore the wrong password counter from its EEPROM log (0 if the log is empty) */
+	if(EEPROM_logInit(&g_attemptsLog,ATTEMPTS_LOG_LOCATION,ATTEMPTS_LOG_SLOTS,ATTEMPTS_LOG_KEY) == SUCCESS)
+	{
+		EEPROM_logRead(&g_attemptsLog,&WrongPasswordCounts,1);
+	}
+
+	/* tell HMI ECU if the first time setup is needed */
+	send_provisioning_state_to_HMIECU(Credential_isProvisioned() ? DEVICE_PROVISIONED : DEVICE_NOT_PROVISIONED);
+
+	/*
+	 * a reset during the alarm doesn't shorten it, it is started again after the provisioning state
+	 * so HMI ECU shows its main menu and gets ERROR_MESSAGE for the options which need a password
+	 */
+	if(Credential_isProvisioned() && (WrongPasswordCounts >= MAX_WRONG_PASSWORDS))
+	{
+		runLockout(FALSE);
+	}
+
+	/* this loop keeps taking inputs until two matches (only if the unit is not provisioned) */
+	while(!Credential_isProvisioned()){
 		/*check if the passwords sent by HMI_ECU are identical and send to it the status*/
 		if(AdjustPassword_FirstTime(first_password,second_password) == SUCCESS)
 		{
@@ -424,22 +570,39 @@ int main(void){
 			send_status_to_HMIECU(PASSWORD_DISMATCH);
 		}
 	}
-	/* This loop to control the selected options taken by user */
+	/*
+	 * This loop to control the selected options taken by user,
+	 * it never blocks so the door cycle keeps running while the frames are handled,
+	 * the CPU is in idle mode when there is nothing to do
+	 */
 	while(1){
-			/* receive the option from HMI ECU*/
-			selected_option = getOption_From_HMIECU();
-
-/* reset the wrong password counter to turn on the alarm  after three consecutive wrong passwords*/
-			WrongPasswordCounts = 0;
-
-			if(selected_option == OPEN_DOOR_OPTION)
+			/* handle the option frames received from HMI ECU and the admin frames (staff codes) */
+			if(PROTOCOL_pollFrame(&frame))
 			{
-				handelOpenDoorOption(first_password,second_password);
+				if((frame.type == PROTOCOL_MSG_OPTION) && (frame.length == 1))
+				{
+					handleOption(frame.payload[0],first_password,second_password);
+				}
+				else if(frame.type == PROTOCOL_MSG_ADMIN)
+				{
+					handleAdminMessage(&frame);
+				}
+				else if(frame.type == PROTOCOL_MSG_DIAG)
+				{
+					handleDiagMessage(&frame);
+				}
+				else if(frame.type == PROTOCOL_MSG_LINK_PROBE)
+				{
+					handleLinkProbe();
+				}
 			}
 
-			else if(selected_option == CHANGE_PASSWORD_OPTION)
-			{
-				handleChangePasswordOption(first_password,second_password);
-			}
+			/* advance the software timers (door cycle) */
+			SwTimer_process();
+
+#if(UART_DRIVER_MODE == UART_INTERRUPT)
+			/* sleep until the next received byte or timer tick */
+			Power_idle();
+#endif
 	}
 }
@@ -11,43 +11,105 @@
 #define CONTROL_ECU_H_
 
 #include "std_types.h"
+#include "door.h"
+#include "credential.h"
+#include "protocol.h"
+#include "user_table.h"
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 #define CONTROL_ECU_ADDRESS 0x44
-#define PASSWORD_LENGTH 5
-#define PASSWORD_LOCATION  0x000
-#define UART_BAUD_RATE 9600
+#define PASSWORD_LENGTH CREDENTIAL_PASSWORD_LENGTH
 
 /********************* These defintions to sync between the 2 ECU **********************/
-#define CONTROL_ECU_READY 0x10
-#define HMI_ECU_READY 0x20
 #define DOOR_IS_OPENING  0X22
 #define DOOR_IS_CLOSING  0X33
 #define DOOR_IS_CLOSED 0X44
+#define DOOR_IS_BUSY 0X88
 #define ERROR_MESSAGE 0xFF
 #define PASSWORD_MATCH 0x11
 #define PASSWORD_DISMATCH 0x00
 #define CONTINUE_PROGRAM 0X55
 #define OPEN_DOOR_OPTION '+'
 #define CHANGE_PASSWORD_OPTION '-'
+#define DOOR_EXTEND_OPTION '='
+#define DOOR_CANCEL_OPTION '*'
+#define DEVICE_PROVISIONED 0X66
+#define DEVICE_NOT_PROVISIONED 0X77
+
+/* extra open time added by every DOOR_EXTEND_OPTION */
+#define DOOR_EXTEND_TIME_MS 5000
+
+/* alarm time after three consecutive wrong passwords */
+#define LOCKOUT_TIME_MS 60000UL
+#define MAX_WRONG_PASSWORDS 3
+
+/* the wrong password counter is kept in a log region of the external EEPROM (16 slots * 16 bytes) */
+#define ATTEMPTS_LOG_LOCATION 0x100
+#define ATTEMPTS_LOG_SLOTS 16
+#define ATTEMPTS_LOG_KEY 'W'
+
+/*
+ * Admin message (PROTOCOL_MSG_ADMIN) to manage the staff codes, it is accepted only with the master password:
+ * Add    : | 'A' | Master Password | User ID | Code | Flags |
+ * Revoke : | 'R' | Master Password | User ID |
+ * the answer is one PROTOCOL_MSG_ADMIN byte: SUCCESS, ERROR (bad message or password) or the user table status.
+ * A wrong master password counts in the wrong password counter, the admin frames are refused during the alarm.
+ */
+#define ADMIN_ADD_USER 'A'
+#define ADMIN_REVOKE_USER 'R'
+#define ADMIN_ADD_LENGTH (3 + PASSWORD_LENGTH + USER_TABLE_CODE_LENGTH)
+#define ADMIN_REVOKE_LENGTH (2 + PASSWORD_LENGTH)
+
+/*
+ * Diagnostic message (PROTOCOL_MSG_DIAG), an empty request is answered by (little endian):
+ * | Idle Permille (2 bytes) | Estimated Current uA (4 bytes) | UART RX Overflow Count (2 bytes) |
+ */
+#define DIAG_ANSWER_LENGTH 8
 /*******************************************************************************
  *                              Functions Prototypes                           *
  *******************************************************************************/
 /*
- * Description : This function recive the password byte by byte from HMIECU and save it into buffer
+ * Description : This function recive the credential frame (the whole password) from HMIECU and save it into buffer
  */
 void receivePassword(uint8* password_ptr);
 
 /*
  * Description : This Function saves the correct password in External EEPROM
+ * and returns the EEPROM status (SUCCESS once the password is really stored)
 */
-void Save_Password_in_EEPROM(const uint8* password_ptr);
+uint8 Save_Password_in_EEPROM(const uint8* password_ptr);
+
+/*
+ * Description : it will handle the option frame sent by HMI ECU (Open door - Change Password - Extend - Cancel)
+ */
+void handleOption(uint8 option,uint8* password_ptr,uint8* EEPROM_password);
+
+/*
+ * Description : it will handle the admin frame (add - revoke a staff code) and answer with its status
+ */
+void handleAdminMessage(const Protocol_FrameType* frame);
+
+/*
+ * Description : it will answer the diagnostic request with the power and link statistics
+ */
+void handleDiagMessage(const Protocol_FrameType* frame);
 
 /*
- * Description : it will get the option from user (Open door - Change Password)
+ * Description : This function runs the alarm for LOCKOUT_TIME_MS after too many wrong passwords (keypad or admin tool),
+ * the admin frames and the open door - change password options received meanwhile are refused
  */
-uint8 getOption_From_HMIECU(void);
+void runLockout(boolean hmi_waiting);
+
+/*
+ * Description : This Function checks if the password is the code of a staff user allowed to open the door
+ */
+boolean isStaffCodeAllowed(const uint8* password);
+
+/*
+ * Description : this is the door state call back function, it informs the HMI ECU about the door state
+ */
+void handleDoorState(Door_StateType state);
 
 /*
  * Description : This function send status to HMI ECU (DOOR_IS_OPENING - DOOR_IS_CLOSING - DOOR_IS_CLOSED)
@@ -55,32 +117,33 @@ uint8 getOption_From_HMIECU(void);
 void send_status_to_HMIECU(uint8 state);
 
 /*
- * Description : This function read the saved paswword from External EERROM
-*/
-void read_Password_in_EEPROM(uint8* password_ptr);
+ * Description : This function answers a link probe of the HMI ECU (it was reset alone) at the baud rate
+ * the probe arrived on, then sends the provisioning state again as the HMI ECU waits for it after its probe
+ */
+void handleLinkProbe(void);
+
+/*
+ * Description : This function sends the provisioning state to HMI ECU at boot (DEVICE_PROVISIONED - DEVICE_NOT_PROVISIONED)
+ */
+void send_provisioning_state_to_HMIECU(uint8 state);
 
 /*
  * Description : This function is to handle open the door request ,
  * It takes Password From HMI_ECU Then:
- * Compares this password with the one saved in EEPROM , if the 2 passwords matches:
- * it will open the door for 15 seconds and send the status for HMI ECU (Door is Opening) to display it on LCD.
+ * Compares this password with the one saved in EEPROM (its SRAM copy) , if the 2 passwords matches:
+ * it will start the door cycle (see door.c) which sends the status for HMI ECU (Door is Opening) to display it on LCD.
  * if the user entered wrong password for three times:
  * the control ECU will Turn on buzzer alarm for 1 minute, send the status for HMI ECU (Error) ,
  * then  control ECU informs the HMI ECU  to continue the program After 1 minute.
 */
-void handelOpenDoorOption(uint8* password_ptr,uint8* EEPROM_password);
-
-/*
- * Description : this is a call back function contains a global variable which increases Every ISR Execution
- */
-void handelTimer(void);
+void handelOpenDoorOption(uint8* password_ptr);
 
 /*
  * Description : This function will take 2 passwords , first one is the password which user entered ,
  * the second one is the password saved in External EEPROM and it will compare the 2 passwords :
  * if they match : save the new password
  */
-void handelChangePasswordOption(uint8* password_ptr,uint8* EEPROM_password);
+void handleChangePasswordOption(uint8* password_ptr,uint8* EEPROM_password);
 
 /*
  * Description : This Function Saves the correct password in External EEPROM if
@@ -88,6 +151,12 @@ void handelChangePasswordOption(uint8* password_ptr,uint8* EEPROM_password);
  */
 uint8 AdjustPassword_FirstTime(uint8* first_password,uint8* second_password);
 
+/*
+ * Description : This Function updates the wrong password counter and appends it in the EEPROM log
+ * (only if it changed) so a reset can't clear the counter before the alarm
+ */
+void setWrongPasswordCounts(uint8 count);
+
 /*
  * Description : This Function check if the 2 entered password are matched or not
 */
@@ -7,34 +7,55 @@ C_SRCS += \
 ../Control_ECU.c \
 ../Timer.c \
 ../buzzer.c \
+../crc.c \
+../credential.c \
+../door.c \
 ../external_eeprom.c \
 ../gpio.c \
 ../motor.c \
+../power.c \
+../protocol.c \
 ../pwm.c \
+../sw_timer.c \
 ../twi.c \
-../uart.c 
+../uart.c \
+../user_table.c 
 
 OBJS += \
 ./Control_ECU.o \
 ./Timer.o \
 ./buzzer.o \
+./crc.o \
+./credential.o \
+./door.o \
 ./external_eeprom.o \
 ./gpio.o \
 ./motor.o \
+./power.o \
+./protocol.o \
 ./pwm.o \
+./sw_timer.o \
 ./twi.o \
-./uart.o 
+./uart.o \
+./user_table.o 
 
 C_DEPS += \
 ./Control_ECU.d \
 ./Timer.d \
 ./buzzer.d \
+./crc.d \
+./credential.d \
+./door.d \
 ./external_eeprom.d \
 ./gpio.d \
 ./motor.d \
+./power.d \
+./protocol.d \
 ./pwm.d \
+./sw_timer.d \
 ./twi.d \
-./uart.d 
+./uart.d \
+./user_table.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
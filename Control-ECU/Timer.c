@@ -26,6 +26,19 @@ static volatile void (*g_callBackPtr1)(void) = NULL_PTR;
 /* Global variables to hold the address of the call back function For Timer 2*/
 static volatile void (*g_callBackPtr2)(void) = NULL_PTR;
 
+/* Uptime clock counters updated by the Timer1 Compare Match ISR while the clock is running */
+static volatile uint32 g_clockMs = 0;
+static volatile uint32 g_clockUs = 0;
+static volatile boolean g_clockRunning = FALSE;
+
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Set/Clear the given TIMSK bits with the interrupts masked, the I-bit is restored as it was */
+static void Timer_enableInterrupts(uint8 mask);
+static void Timer_disableInterrupts(uint8 mask);
 
 /*******************************************************************************
  *                       Interrupt Service Routines                            *
@@ -64,6 +77,11 @@ ISR(TIMER1_OVF_vect)
 /******************************* ISR For Timer1 Compare Match Mode (Channel A) ***********************************/
 ISR(TIMER1_COMPA_vect)
 {
+	if(g_clockRunning)
+	{
+		g_clockMs += CLOCK_TICK_MS;
+		g_clockUs += CLOCK_US_PER_TICK;
+	}
 	if(g_callBackPtr1 != NULL_PTR)
 	{
 		/* Call the Call Back function in the application after Timer1 Compare Match Occurs*/
@@ -103,6 +121,7 @@ ISR(TIMER2_COMP_vect)
  3- The Timer Prescalar
  4- The Timer Initial Value That will start counting from it
  5- The The Timer Compare Value (In Compare Mode Only)
+ The global interrupt (I-bit) is left to the application.
 */
 void Timer_init(const Timer_ConfigType* Timer_Config)
 {
@@ -124,10 +143,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			TCNT0 = Timer_Config->Timer_Initial_value;
 
 			// Timer0 Overflow Interrupt Enable
-			TIMSK |= (1 << TOIE0);
-
-			// Global Interrupt Enable (I-bit)
-			SREG  |= (1<<7);
+			Timer_enableInterrupts(1<<TOIE0);
 		}
 
 		else if(Timer_Config->Timer_mode == Compare_mode)
@@ -148,10 +164,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			OCR0 = Timer_Config->Timer_Compare_value;
 
 			// Timer0 Compare Match Interrupt Enable
-			TIMSK |= (1 << OCIE0);
-
-			// Global Interrupt Enable (I-bit)
-			SREG  |= (1<<7);
+			Timer_enableInterrupts(1<<OCIE0);
 		}
 	}
 
@@ -174,10 +187,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			TCNT1 = Timer_Config->Timer_Initial_value;
 
 			// Timer1 Overflow Interrupt Enable
-			TIMSK |= (1<<TOIE1);
-
-			// Global Interrupt Enable (I-bit)
-			SREG  |= (1<<7);
+			Timer_enableInterrupts(1<<TOIE1);
 
 		}
 
@@ -200,10 +210,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			OCR1A = Timer_Config->Timer_Compare_value;
 
 			// Timer1 Compare Match Interrupt Enable (Channel A)
-			TIMSK |= (1 << OCIE1A);
-
-			// Global Interrupt Enable (I-bit)
-			SREG  |= (1<<7);
+			Timer_enableInterrupts(1<<OCIE1A);
 
 		}
 	}
@@ -226,10 +233,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			 TCNT2 = Timer_Config->Timer_Initial_value;
 
 			 // Timer2 Overflow Interrupt Enable
-			 TIMSK |= (1 << TOIE2);
-
-			 // Global Interrupt Enable (I-bit)
-			 SREG  |= (1<<7);
+			 Timer_enableInterrupts(1<<TOIE2);
 
 		}
 
@@ -250,10 +254,7 @@ void Timer_init(const Timer_ConfigType* Timer_Config)
 			 OCR2 = Timer_Config->Timer_Compare_value;
 
 			 // Timer2 Compare Match Interrupt Enable
-			 TIMSK |= (1 << OCIE2);
-
-			// Global Interrupt Enable (I-bit)
-			SREG  |= (1<<7);
+			 Timer_enableInterrupts(1<<OCIE2);
 		}
 	}
 }
@@ -289,7 +290,34 @@ void Timer2_setCallBack(void(*T2_ptr)(void))
 /**********************************************************************************************************/
 
 /*
- * Description: Function to disable the Timer driver
+ * Description: Set the interrupt enable bits of one timer in TIMSK.
+ * TIMSK is shared by the three timers so the read-modify-write is done with the interrupts
+ * masked, then the I-bit is restored to its previous state (the driver never enables it by itself).
+ */
+static void Timer_enableInterrupts(uint8 mask)
+{
+	uint8 sreg = SREG;
+	cli();
+	TIMSK |= mask;
+	SREG = sreg;
+}
+
+/*
+ * Description: Clear the interrupt enable bits of one timer in TIMSK (see Timer_enableInterrupts).
+ */
+static void Timer_disableInterrupts(uint8 mask)
+{
+	uint8 sreg = SREG;
+	cli();
+	TIMSK &= ~mask;
+	SREG = sreg;
+}
+
+/**********************************************************************************************************/
+
+/*
+ * Description: Function to disable the Timer driver,
+ * only the interrupts of this timer are disabled, the global interrupt (I-bit) is not touched.
  */
 void Timer_DeInit(Timer_Number Timer_ID)
 {
@@ -301,31 +329,21 @@ void Timer_DeInit(Timer_Number Timer_ID)
 			TCNT0 = 0;
 			OCR0 = 0;
 
-			// Timer0 Overflow Interrupt Disable
-			TIMSK &= ~(1 << TOIE0);
-
-			// Timer0 Compare Match Interrupt Disable
-			TIMSK &= ~(1 << OCIE0);
+			// Timer0 Overflow and Compare Match Interrupts Disable (only this timer bits)
+			Timer_disableInterrupts((1<<TOIE0) | (1<<OCIE0));
 
-			// Global Interrupt Disable (I-bit)
-			SREG  &= ~(1<<7);
 			break;
 
 
 		case Timer1:
+			g_clockRunning = FALSE;
 			TCCR1A = 0;
 			TCCR1B = 0;
 			TCNT1 = 0;
 			OCR1A = 0;
 
-			// Timer1 Overflow Interrupt Disable
-			TIMSK &= ~(1<<TOIE1);
-
-			// Timer1 Compare Match Interrupt Disable (Channel A)
-			TIMSK &= ~(1 << OCIE1A);
-
-			// Global Interrupt Disable (I-bit)
-			SREG  &= ~(1<<7);
+			// Timer1 Overflow and Compare Match Interrupts Disable (only this timer bits)
+			Timer_disableInterrupts((1<<TOIE1) | (1<<OCIE1A));
 			break;
 
 
@@ -334,17 +352,67 @@ void Timer_DeInit(Timer_Number Timer_ID)
 			TCNT2 = 0;
 			OCR2 = 0;
 
-			// Timer2 Overflow Interrupt Disable
-			TIMSK &= ~(1 << TOIE2);
-
-			// Timer2 Compare Match Interrupt Disable
-			 TIMSK &= ~(1 << OCIE2);
-
-			// Global Interrupt Disable (I-bit)
-			SREG  &= ~(1<<7);
+			// Timer2 Overflow and Compare Match Interrupts Disable (only this timer bits)
+			Timer_disableInterrupts((1<<TOIE2) | (1<<OCIE2));
 			break;
 
 	}
 }
 
+/**********************************************************************************************************/
 
+/*
+ * Description: Start the uptime clock on Timer1 (1ms tick), the Timer1 call back function
+ * is still called every tick so it can be set before or after this function.
+ */
+void Clock_init(void)
+{
+	Timer_ConfigType s_clock_config = TIMER_CONFIG_MS(Timer1,CLOCK_TICK_MS);
+
+	g_clockMs = 0;
+	g_clockUs = 0;
+	g_clockRunning = TRUE;
+	Timer_init(&s_clock_config);
+}
+
+/*
+ * Description: Return the ms since Clock_init (wraps after ~49.7 days).
+ * A tick which is pending while the interrupts are masked is counted too.
+ */
+uint32 Clock_nowMs(void)
+{
+	uint32 ms;
+	uint8 sreg = SREG;
+
+	cli();
+	ms = g_clockMs;
+	if(TIFR & (1<<OCF1A))
+	{
+		ms += CLOCK_TICK_MS;
+	}
+	SREG = sreg;
+	return ms;
+}
+
+/*
+ * Description: Return the us since Clock_init (wraps after ~71.6 minutes).
+ * If the compare match happened but its ISR is not served yet TCNT1 has already restarted
+ * from 0 so it is read again and the pending tick is added.
+ */
+uint32 Clock_nowUs(void)
+{
+	uint32 us;
+	uint16 counts;
+	uint8 sreg = SREG;
+
+	cli();
+	us = g_clockUs;
+	counts = TCNT1;
+	if(TIFR & (1<<OCF1A))
+	{
+		counts = TCNT1;
+		us += CLOCK_US_PER_TICK;
+	}
+	SREG = sreg;
+	return us + (counts / (uint16)CLOCK_COUNTS_PER_US);
+}
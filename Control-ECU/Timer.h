@@ -15,6 +15,116 @@
 
 #include "std_types.h"
 
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Compile-time timer configuration:
+ * TIMER_CONFIG_MS(Timer1,15000) / TIMER_CONFIG_US(Timer0,500) expand to a Timer_ConfigType
+ * initializer in Compare Match Mode, for the given ID and F_CPU they pick:
+ * 1- The smallest prescaler which reaches the period in one compare match (best resolution),
+ *    if no prescaler can do it the largest one is used with several compare matches
+ * 2- The compare value
+ * 3- The number of compare match interrupts of one period TIMER_INTERRUPTS_MS/US(ID,time)
+ * The build fails (negative array size) if the period is missed by more than TIMER_MAX_ERROR_PPM.
+ * All the calculations are unsigned long long so they can also be used in #if.
+ */
+#define TIMER_MAX_ERROR_PPM            1000ULL
+
+/* Counts of each timer before overflow (8-bit Timer0/Timer2 - 16-bit Timer1) */
+#define TIMER_MAX_COUNT_Timer0         256ULL
+#define TIMER_MAX_COUNT_Timer1         65536ULL
+#define TIMER_MAX_COUNT_Timer2         256ULL
+
+/* Periods in CPU cycles */
+#define TIMER_MS_TO_CYCLES(MS)         (((F_CPU) / 1000ULL) * (MS))
+#define TIMER_US_TO_CYCLES(US)         (((F_CPU) / 1000000ULL) * (US))
+
+#define TIMER_FITS(ID,CYCLES,DIV)      ((CYCLES) <= ((DIV) * TIMER_MAX_COUNT_##ID))
+
+/* Prescaler (clock divider) of each timer: Timer0/Timer1 (1,8,64,256,1024) - Timer2 (1,8,32,64,128,256,1024) */
+#define TIMER_DIVIDER_Timer0(CYCLES)   TIMER_DIVIDER_T01(Timer0,CYCLES)
+#define TIMER_DIVIDER_Timer1(CYCLES)   TIMER_DIVIDER_T01(Timer1,CYCLES)
+#define TIMER_DIVIDER_T01(ID,CYCLES) \
+	(TIMER_FITS(ID,CYCLES,1ULL) ? 1ULL : TIMER_FITS(ID,CYCLES,8ULL) ? 8ULL : \
+	 TIMER_FITS(ID,CYCLES,64ULL) ? 64ULL : TIMER_FITS(ID,CYCLES,256ULL) ? 256ULL : 1024ULL)
+#define TIMER_DIVIDER_Timer2(CYCLES) \
+	(TIMER_FITS(Timer2,CYCLES,1ULL) ? 1ULL : TIMER_FITS(Timer2,CYCLES,8ULL) ? 8ULL : \
+	 TIMER_FITS(Timer2,CYCLES,32ULL) ? 32ULL : TIMER_FITS(Timer2,CYCLES,64ULL) ? 64ULL : \
+	 TIMER_FITS(Timer2,CYCLES,128ULL) ? 128ULL : TIMER_FITS(Timer2,CYCLES,256ULL) ? 256ULL : 1024ULL)
+#define TIMER_DIVIDER(ID,CYCLES)       TIMER_DIVIDER_##ID(CYCLES)
+
+/* Clock select bits (CS2:0) of the chosen prescaler */
+#define TIMER_CS_Timer0(DIV)           TIMER_CS_T01(DIV)
+#define TIMER_CS_Timer1(DIV)           TIMER_CS_T01(DIV)
+#define TIMER_CS_T01(DIV) \
+	((DIV) == 1ULL ? 1 : (DIV) == 8ULL ? 2 : (DIV) == 64ULL ? 3 : (DIV) == 256ULL ? 4 : 5)
+#define TIMER_CS_Timer2(DIV) \
+	((DIV) == 1ULL ? 1 : (DIV) == 8ULL ? 2 : (DIV) == 32ULL ? 3 : (DIV) == 64ULL ? 4 : \
+	 (DIV) == 128ULL ? 5 : (DIV) == 256ULL ? 6 : 7)
+
+/* Prescaler fields of Timer_ConfigType (Timer2 has its own prescaler field) */
+#define TIMER_PRESCALAR_FIELDS_Timer0(CS)  (Timer_Prescalar)(CS),no_clock
+#define TIMER_PRESCALAR_FIELDS_Timer1(CS)  (Timer_Prescalar)(CS),no_clock
+#define TIMER_PRESCALAR_FIELDS_Timer2(CS)  No_Clock,(Timer2_Prescalar)(CS)
+
+/* Compare matches of one period, compare value and the period which is really generated */
+#define TIMER_INTERRUPTS_CYCLES(ID,CYCLES) \
+	(((CYCLES) + (TIMER_DIVIDER(ID,CYCLES) * TIMER_MAX_COUNT_##ID) - 1ULL) / (TIMER_DIVIDER(ID,CYCLES) * TIMER_MAX_COUNT_##ID))
+#define TIMER_STEP_CYCLES(ID,CYCLES)   (TIMER_DIVIDER(ID,CYCLES) * TIMER_INTERRUPTS_CYCLES(ID,CYCLES))
+#define TIMER_COUNTS_CYCLES(ID,CYCLES) (((CYCLES) + (TIMER_STEP_CYCLES(ID,CYCLES) / 2ULL)) / TIMER_STEP_CYCLES(ID,CYCLES))
+#define TIMER_ACTUAL_CYCLES(ID,CYCLES) (TIMER_STEP_CYCLES(ID,CYCLES) * TIMER_COUNTS_CYCLES(ID,CYCLES))
+
+/* Error of the generated period in ppm */
+#define TIMER_ERROR_PPM_CYCLES(ID,CYCLES) \
+	((((TIMER_ACTUAL_CYCLES(ID,CYCLES) > (CYCLES)) ? (TIMER_ACTUAL_CYCLES(ID,CYCLES) - (CYCLES)) : \
+	   ((CYCLES) - TIMER_ACTUAL_CYCLES(ID,CYCLES))) * 1000000ULL) / (CYCLES))
+
+/* TRUE if the period can be generated (at least one count per compare match) within the tolerance */
+#define TIMER_IS_VALID_CYCLES(ID,CYCLES) \
+	(((CYCLES) != 0ULL) && (TIMER_COUNTS_CYCLES(ID,CYCLES) >= 1ULL) && \
+	 (TIMER_COUNTS_CYCLES(ID,CYCLES) <= TIMER_MAX_COUNT_##ID) && \
+	 (TIMER_ERROR_PPM_CYCLES(ID,CYCLES) <= TIMER_MAX_ERROR_PPM))
+
+/* Timer_ConfigType initializer, the initial value field carries the compile-time check (it is always 0) */
+#define TIMER_CONFIG_CYCLES(ID,CYCLES) \
+	{ID,Compare_mode,TIMER_PRESCALAR_FIELDS_##ID(TIMER_CS_##ID(TIMER_DIVIDER(ID,CYCLES))), \
+	 0 * sizeof(char[TIMER_IS_VALID_CYCLES(ID,CYCLES) ? 1 : -1]), \
+	 TIMER_COUNTS_CYCLES(ID,CYCLES) - 1ULL}
+
+#define TIMER_CONFIG_MS(ID,MS)         TIMER_CONFIG_CYCLES(ID,TIMER_MS_TO_CYCLES(MS))
+#define TIMER_CONFIG_US(ID,US)         TIMER_CONFIG_CYCLES(ID,TIMER_US_TO_CYCLES(US))
+#define TIMER_INTERRUPTS_MS(ID,MS)     TIMER_INTERRUPTS_CYCLES(ID,TIMER_MS_TO_CYCLES(MS))
+#define TIMER_INTERRUPTS_US(ID,US)     TIMER_INTERRUPTS_CYCLES(ID,TIMER_US_TO_CYCLES(US))
+#define TIMER_IS_VALID_MS(ID,MS)       TIMER_IS_VALID_CYCLES(ID,TIMER_MS_TO_CYCLES(MS))
+#define TIMER_IS_VALID_US(ID,US)       TIMER_IS_VALID_CYCLES(ID,TIMER_US_TO_CYCLES(US))
+
+/*
+ * Uptime clock: Timer1 in Compare Match Mode every CLOCK_TICK_MS counts the ms and the us since Clock_init,
+ * the us between two ticks are read from TCNT1. The ms clock wraps after ~49.7 days and the us clock
+ * after ~71.6 minutes so the times should only be compared with the macros below.
+ */
+#define CLOCK_TICK_MS                  1UL
+#define CLOCK_US_PER_TICK              (CLOCK_TICK_MS * 1000UL)
+#define CLOCK_COUNTS_PER_TICK          TIMER_COUNTS_CYCLES(Timer1,TIMER_MS_TO_CYCLES(CLOCK_TICK_MS))
+#define CLOCK_COUNTS_PER_US            (CLOCK_COUNTS_PER_TICK / CLOCK_US_PER_TICK)
+
+#if((!TIMER_IS_VALID_MS(Timer1,CLOCK_TICK_MS)) || (TIMER_INTERRUPTS_MS(Timer1,CLOCK_TICK_MS) != 1))
+
+#error "The clock tick can't be generated by one Timer1 compare match"
+
+#elif((CLOCK_COUNTS_PER_US == 0) || ((CLOCK_COUNTS_PER_TICK % CLOCK_US_PER_TICK) != 0))
+
+#error "Timer1 should count a whole number of times per us to be used as a us clock"
+
+#endif
+
+/* Wraparound safe helpers, valid while the two times are less than half the clock range apart */
+#define CLOCK_ELAPSED(START,NOW)       ((uint32)((uint32)(NOW) - (uint32)(START)))
+#define CLOCK_IS_BEFORE(A,B)           ((sint32)((uint32)(A) - (uint32)(B)) < 0)
+#define CLOCK_IS_REACHED(NOW,DEADLINE) ((sint32)((uint32)(NOW) - (uint32)(DEADLINE)) >= 0)
+
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
@@ -78,6 +188,7 @@ typedef struct
  3- The Timer Prescalar
  4- The Timer Initial Value That will start counting from it
  5- The The Timer Compare Value (In Compare Mode Only)
+ The global interrupt (I-bit) is left to the application.
 */
 void Timer_init(const Timer_ConfigType* Timer_Config);
 
@@ -102,5 +213,21 @@ void Timer2_setCallBack(void(*T2_ptr)(void));
  */
 void Timer_DeInit(Timer_Number Timer_ID);
 
+/*
+ * Description: Start the uptime clock on Timer1 (1ms tick), the Timer1 call back function
+ * is still called every tick so it can be set before or after this function.
+ */
+void Clock_init(void);
+
+/*
+ * Description: Return the ms since Clock_init (wraps after ~49.7 days).
+ */
+uint32 Clock_nowMs(void);
+
+/*
+ * Description: Return the us since Clock_init (wraps after ~71.6 minutes).
+ */
+uint32 Clock_nowUs(void);
+
 
 #endif /* TIMER_H_ */
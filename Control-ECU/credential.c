@@ -0,0 +1,263 @@
+ /******************************************************************************
+ *
+ * Module: Credential
+ *
+ * File Name: credential.c
+ *
+ * Description: Source file for the password cache (SRAM copy of the password saved in the external EEPROM)
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "credential.h"
+#include "crc.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* SRAM copy of the saved password */
+static uint8 g_password[CREDENTIAL_PASSWORD_LENGTH];
+
+/* TRUE once the cache holds a password with a valid CRC */
+static boolean g_valid = FALSE;
+
+/* Slot of the cached password (0 for slot A, 1 for slot B) and its generation */
+static uint8 g_slot = 0;
+static uint8 g_generation = 0;
+
+/* Locations of the password slots */
+static const uint16 g_slotLocation[2] = {CREDENTIAL_SLOT_A_LOCATION,CREDENTIAL_SLOT_B_LOCATION};
+
+/* TRUE once the provisioning header is valid */
+static boolean g_headerValid = FALSE;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Fill the provisioning header of the current layout version */
+static void Credential_makeHeader(uint8 *header);
+
+/* Read a password slot, returns TRUE if its CRC is valid */
+static boolean Credential_readSlot(uint8 slot,uint8 *record);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the two password slots (A/B) and load the newest valid one in SRAM (see Credential_selectSlot),
+ * the cache is valid only if one of the slots has a valid CRC, its slot and generation are kept for the next store,
+ * then check the provisioning header (the I-bit must be set as the EEPROM driver is interrupt driven).
+ */
+void Credential_init(void)
+{
+	uint8 record[2][CREDENTIAL_RECORD_LENGTH];
+	boolean valid[2];
+	uint8 header[CREDENTIAL_HEADER_LENGTH];
+	uint8 saved_header[CREDENTIAL_HEADER_LENGTH];
+	uint8 slot;
+	uint8 i;
+
+	g_valid = FALSE;
+	g_headerValid = FALSE;
+
+	/* The header must match the one of this layout version byte by byte */
+	if(EEPROM_readBlock(CREDENTIAL_HEADER_LOCATION,saved_header,CREDENTIAL_HEADER_LENGTH) == SUCCESS)
+	{
+		Credential_makeHeader(header);
+		g_headerValid = TRUE;
+		for(i = 0;i < CREDENTIAL_HEADER_LENGTH;i++)
+		{
+			if(header[i] != saved_header[i])
+			{
+				g_headerValid = FALSE;
+			}
+		}
+	}
+
+	/* One block read per slot */
+	valid[0] = Credential_readSlot(0,record[0]);
+	valid[1] = Credential_readSlot(1,record[1]);
+
+	slot = Credential_selectSlot(valid[0],record[0][CREDENTIAL_PASSWORD_LENGTH],valid[1],record[1][CREDENTIAL_PASSWORD_LENGTH]);
+	if(slot == CREDENTIAL_NO_SLOT)
+	{
+		return;
+	}
+
+	for(i = 0;i < CREDENTIAL_PASSWORD_LENGTH;i++)
+	{
+		g_password[i] = record[slot][i];
+	}
+	g_slot = slot;
+	g_generation = record[slot][CREDENTIAL_PASSWORD_LENGTH];
+	g_valid = TRUE;
+}
+
+/*
+ * Description :
+ * Select the slot to load from the CRC result and the generation of each slot:
+ * the valid one, or the newest one if both are valid (the generations are compared modulo 256 as
+ * the two slots differ by one), returns 0 for slot A, 1 for slot B or CREDENTIAL_NO_SLOT.
+ */
+uint8 Credential_selectSlot(boolean valid_a,uint8 generation_a,boolean valid_b,uint8 generation_b)
+{
+	if(valid_a && valid_b)
+	{
+		/* Both are valid: the newest generation wins (255 --> 0 is one step ahead) */
+		return ((sint8)(uint8)(generation_b - generation_a) > 0) ? 1 : 0;
+	}
+	else if(valid_a)
+	{
+		return 0;
+	}
+	else if(valid_b)
+	{
+		return 1;
+	}
+	else
+	{
+		return CREDENTIAL_NO_SLOT;
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the cache holds a valid password.
+ */
+boolean Credential_isValid(void)
+{
+	return g_valid;
+}
+
+/*
+ * Description :
+ * Return TRUE if the provisioning header is valid and the cache holds a valid password,
+ * the first time setup is then skipped.
+ */
+boolean Credential_isProvisioned(void)
+{
+	return g_headerValid && g_valid;
+}
+
+/*
+ * Description :
+ * Compare the password with the cached one (no EEPROM access), returns FALSE if the cache is not valid.
+ */
+boolean Credential_match(const uint8 *password)
+{
+	uint8 i;
+
+	if(!g_valid)
+	{
+		return FALSE;
+	}
+
+	for(i = 0;i < CREDENTIAL_PASSWORD_LENGTH;i++)
+	{
+		if(password[i] != g_password[i])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Save the password in the older slot with the next generation and its CRC (write-through) then update the cache,
+ * the slot of the current password is never written so a failed write keeps it valid,
+ * the provisioning header is written after the first password,
+ * returns the EEPROM status (SUCCESS, ERROR or EEPROM_TIMEOUT), the cache is unchanged if the write fails.
+ */
+uint8 Credential_store(const uint8 *password)
+{
+	uint8 record[CREDENTIAL_RECORD_LENGTH];
+	uint8 header[CREDENTIAL_HEADER_LENGTH];
+	uint8 slot;
+	uint8 generation;
+	uint8 status;
+	uint8 i;
+
+	/* The first password goes to slot A, then the slots are used in turn */
+	if(g_valid)
+	{
+		slot = g_slot ^ 1;
+		generation = g_generation + 1;
+	}
+	else
+	{
+		slot = 0;
+		generation = 0;
+	}
+
+	for(i = 0;i < CREDENTIAL_PASSWORD_LENGTH;i++)
+	{
+		record[i] = password[i];
+	}
+	record[CREDENTIAL_PASSWORD_LENGTH] = generation;
+	record[CREDENTIAL_PASSWORD_LENGTH + 1] = CRC8_calculate(record,CREDENTIAL_PASSWORD_LENGTH + 1);
+
+	/*
+	 * The record fits in one page so it is written in one write cycle,
+	 * the new password is used only after the write is done (a reset before keeps the current slot)
+	 */
+	status = EEPROM_writeBlock(g_slotLocation[slot],record,CREDENTIAL_RECORD_LENGTH);
+	if(status != SUCCESS)
+	{
+		return status;
+	}
+
+	for(i = 0;i < CREDENTIAL_PASSWORD_LENGTH;i++)
+	{
+		g_password[i] = password[i];
+	}
+	g_slot = slot;
+	g_generation = generation;
+	g_valid = TRUE;
+
+	/* The header is written after the password so a reset between the two writes only repeats the setup */
+	if(!g_headerValid)
+	{
+		Credential_makeHeader(header);
+		status = EEPROM_writeBlock(CREDENTIAL_HEADER_LOCATION,header,CREDENTIAL_HEADER_LENGTH);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+		g_headerValid = TRUE;
+	}
+
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Fill the provisioning header of the current layout version.
+ */
+static void Credential_makeHeader(uint8 *header)
+{
+	header[0] = CREDENTIAL_MAGIC_0;
+	header[1] = CREDENTIAL_MAGIC_1;
+	header[2] = CREDENTIAL_LAYOUT_VERSION;
+	header[3] = CRC8_calculate(header,CREDENTIAL_HEADER_LENGTH - 1);
+}
+
+/*
+ * Description :
+ * Read a password slot, returns TRUE if its CRC is valid.
+ */
+static boolean Credential_readSlot(uint8 slot,uint8 *record)
+{
+	if(EEPROM_readBlock(g_slotLocation[slot],record,CREDENTIAL_RECORD_LENGTH) != SUCCESS)
+	{
+		return FALSE;
+	}
+
+	return (CRC8_calculate(record,CREDENTIAL_PASSWORD_LENGTH + 1) == record[CREDENTIAL_PASSWORD_LENGTH + 1]);
+}
@@ -0,0 +1,94 @@
+ /******************************************************************************
+ *
+ * Module: Credential
+ *
+ * File Name: credential.h
+ *
+ * Description: Header file for the password cache (SRAM copy of the password saved in the external EEPROM)
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef CREDENTIAL_H_
+#define CREDENTIAL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The password is saved in two slots (A/B), each one in its own page:
+ * | Password (CREDENTIAL_PASSWORD_LENGTH bytes) | Generation | CRC-8 of the password and the generation |
+ * A new password is written in the older slot with the next generation, so a reset during the write
+ * leaves the other slot (the current password) valid, the newest valid slot is used at boot.
+ */
+#define CREDENTIAL_PASSWORD_LENGTH     5
+#define CREDENTIAL_SLOT_A_LOCATION     0x000
+#define CREDENTIAL_SLOT_B_LOCATION     0x020
+#define CREDENTIAL_RECORD_LENGTH       (CREDENTIAL_PASSWORD_LENGTH + 2)
+
+/* Credential_selectSlot result when none of the slots is valid */
+#define CREDENTIAL_NO_SLOT             0xFF
+
+/*
+ * Provisioning header in its own page, written once the first password is stored:
+ * | Magic (2 bytes) | Layout Version | CRC-8 of the magic and the version |
+ * A unit is provisioned if the header and the password record are both valid,
+ * a new layout version makes the old units run the first time setup again.
+ */
+#define CREDENTIAL_HEADER_LOCATION     0x010
+#define CREDENTIAL_HEADER_LENGTH       4
+#define CREDENTIAL_MAGIC_0             'D'
+#define CREDENTIAL_MAGIC_1             'L'
+#define CREDENTIAL_LAYOUT_VERSION      3
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the two password slots and load the newest valid one in SRAM, the cache is valid only if
+ * one of the slots has a valid CRC, then check the provisioning header (the I-bit must be set as the EEPROM driver is interrupt driven).
+ */
+void Credential_init(void);
+
+/*
+ * Description :
+ * Select the slot to load from the CRC result and the generation of each slot:
+ * the valid one, or the newest one if both are valid (the generations are compared modulo 256 as
+ * the two slots differ by one), returns 0 for slot A, 1 for slot B or CREDENTIAL_NO_SLOT.
+ */
+uint8 Credential_selectSlot(boolean valid_a,uint8 generation_a,boolean valid_b,uint8 generation_b);
+
+/*
+ * Description :
+ * Return TRUE if the cache holds a valid password.
+ */
+boolean Credential_isValid(void);
+
+/*
+ * Description :
+ * Return TRUE if the provisioning header is valid and the cache holds a valid password,
+ * the first time setup is then skipped.
+ */
+boolean Credential_isProvisioned(void);
+
+/*
+ * Description :
+ * Compare the password with the cached one (no EEPROM access), returns FALSE if the cache is not valid.
+ */
+boolean Credential_match(const uint8 *password);
+
+/*
+ * Description :
+ * Save the password in the older slot with the next generation (write-through) then update the cache,
+ * the current slot is never written so a failed write keeps the old password, the provisioning header is written after the first password,
+ * returns the EEPROM status (SUCCESS, ERROR or EEPROM_TIMEOUT), the cache is unchanged if the write fails.
+ */
+uint8 Credential_store(const uint8 *password);
+
+#endif /* CREDENTIAL_H_ */
@@ -0,0 +1,202 @@
+/******************************************************************************
+ *
+ * Module: Door
+ *
+ * File Name: door.c
+ *
+ * Description: Source file for the non-blocking door cycle state machine
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "door.h"
+#include "motor.h"
+#include "sw_timer.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Current state of the door */
+static Door_StateType g_doorState = DOOR_IDLE;
+
+/* Software timer of the current state */
+static SwTimer_Type g_doorTimer = {NULL_PTR};
+
+/* Hold time of the running cycle (can be extended while opening) */
+static uint32 g_holdTimeMs = 0;
+
+/* Global variables to hold the address of the call back function */
+static void (*g_doorCallBackPtr)(Door_StateType) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Call back function of the door software timer */
+static void Door_timeout(void *context);
+
+/* Move the door to the required state for the required time and notify the application */
+static void Door_enterState(Door_StateType state,uint32 time_ms);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the door state machine, SwTimer_init must be called before it.
+ */
+void Door_init(void)
+{
+	SwTimer_stop(&g_doorTimer);
+	g_doorState = DOOR_IDLE;
+}
+
+/*
+ * Description: Function to set the Call Back function which is called (from SwTimer_process)
+ * every time the door enters a new state.
+ */
+void Door_setCallBack(void(*a_ptr)(Door_StateType))
+{
+	g_doorCallBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Start a new door cycle, returns FALSE if a cycle is already running.
+ */
+boolean Door_startCycle(void)
+{
+	if(Door_isBusy())
+	{
+		return FALSE;
+	}
+
+	g_holdTimeMs = DOOR_HOLD_TIME_MS;
+	Door_enterState(DOOR_OPENING,DOOR_OPENING_TIME_MS);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Cancel the running cycle: an opening door closes back from where it is,
+ * a held door starts closing now. Returns FALSE if the door is not opening or held.
+ */
+boolean Door_cancelCycle(void)
+{
+	if(g_doorState == DOOR_OPENING)
+	{
+		/* Close for the same time the door has been opening */
+		Door_enterState(DOOR_CLOSING,DOOR_OPENING_TIME_MS - SwTimer_remainingMs(&g_doorTimer));
+		return TRUE;
+	}
+	else if(g_doorState == DOOR_HOLD)
+	{
+		Door_enterState(DOOR_CLOSING,DOOR_CLOSING_TIME_MS);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Keep the door open extra_ms longer than planned.
+ * Returns FALSE if the door is not opening or held.
+ */
+boolean Door_extendHold(uint16 extra_ms)
+{
+	if(g_doorState == DOOR_OPENING)
+	{
+		g_holdTimeMs += extra_ms;
+		return TRUE;
+	}
+	else if(g_doorState == DOOR_HOLD)
+	{
+		SwTimer_start(&g_doorTimer,SwTimer_remainingMs(&g_doorTimer) + extra_ms,0,Door_timeout,NULL_PTR);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Return the current state of the door.
+ */
+Door_StateType Door_getState(void)
+{
+	return g_doorState;
+}
+
+/*
+ * Description :
+ * Return TRUE while a door cycle is running.
+ */
+boolean Door_isBusy(void)
+{
+	return (g_doorState == DOOR_OPENING) || (g_doorState == DOOR_HOLD) || (g_doorState == DOOR_CLOSING);
+}
+
+/*
+ * Description :
+ * Call back function of the door software timer, the current state is over so move to the next one.
+ */
+static void Door_timeout(void *context)
+{
+	switch(g_doorState)
+	{
+		case DOOR_OPENING:
+			Door_enterState(DOOR_HOLD,g_holdTimeMs);
+			break;
+
+		case DOOR_HOLD:
+			Door_enterState(DOOR_CLOSING,DOOR_CLOSING_TIME_MS);
+			break;
+
+		case DOOR_CLOSING:
+			Door_enterState(DOOR_CLOSED,0);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Description :
+ * Move the door to the required state for the required time, drive the motor and notify the application.
+ */
+static void Door_enterState(Door_StateType state,uint32 time_ms)
+{
+	g_doorState = state;
+
+	switch(state)
+	{
+		case DOOR_OPENING:
+			DcMotor_Rotate(CW,DOOR_MOTOR_SPEED);
+			break;
+
+		case DOOR_CLOSING:
+			DcMotor_Rotate(A_CW,DOOR_MOTOR_SPEED);
+			break;
+
+		default:
+			DcMotor_Rotate(STOP,0);
+			break;
+	}
+
+	if(Door_isBusy())
+	{
+		SwTimer_start(&g_doorTimer,time_ms,0,Door_timeout,NULL_PTR);
+	}
+	else
+	{
+		SwTimer_stop(&g_doorTimer);
+	}
+
+	if(g_doorCallBackPtr != NULL_PTR)
+	{
+		(*g_doorCallBackPtr)(state);
+	}
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * Module: Door
+ *
+ * File Name: door.h
+ *
+ * Description: Header file for the non-blocking door cycle state machine
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef DOOR_H_
+#define DOOR_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Door cycle timings, every state is timed by a software timer (see sw_timer.h) */
+#define DOOR_OPENING_TIME_MS           15000UL
+#define DOOR_HOLD_TIME_MS              3000UL
+#define DOOR_CLOSING_TIME_MS           15000UL
+
+#define DOOR_MOTOR_SPEED               100
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Door cycle states: IDLE --> OPENING --> HOLD --> CLOSING --> CLOSED */
+typedef enum
+{
+	DOOR_IDLE,DOOR_OPENING,DOOR_HOLD,DOOR_CLOSING,DOOR_CLOSED
+}Door_StateType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the door state machine, SwTimer_init must be called before it.
+ */
+void Door_init(void);
+
+/*
+ * Description: Function to set the Call Back function which is called (from SwTimer_process)
+ * every time the door enters a new state.
+ */
+void Door_setCallBack(void(*a_ptr)(Door_StateType));
+
+/*
+ * Description :
+ * Start a new door cycle, returns FALSE if a cycle is already running.
+ */
+boolean Door_startCycle(void);
+
+/*
+ * Description :
+ * Cancel the running cycle: an opening door closes back from where it is,
+ * a held door starts closing now. Returns FALSE if the door is not opening or held.
+ */
+boolean Door_cancelCycle(void);
+
+/*
+ * Description :
+ * Keep the door open extra_ms longer than planned.
+ * Returns FALSE if the door is not opening or held.
+ */
+boolean Door_extendHold(uint16 extra_ms);
+
+/*
+ * Description :
+ * Return the current state of the door.
+ */
+Door_StateType Door_getState(void);
+
+/*
+ * Description :
+ * Return TRUE while a door cycle is running.
+ */
+boolean Door_isBusy(void);
+
+#endif /* DOOR_H_ */
@@ -10,73 +10,348 @@
  *
  *******************************************************************************/
 #include "external_eeprom.h"
-#include "twi.h"
+#include "power.h" /* To wait in idle mode */
+#include "crc.h" /* For the log entries */
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Fill the TWI transaction of the request and queue it */
+static void EEPROM_submit(EEPROM_RequestType *request,uint16 u16addr,uint8 write_length,uint8 *read_data,uint16 read_length,EEPROM_CallBackType a_ptr,void *context);
+
+/* TWI call back function, it does the ACK polling then ends the request */
+static void EEPROM_transactionDone(uint8 status,void *context);
+
+/* Read the entry of a log slot and check it, *valid is TRUE for a valid entry of the log key */
+static uint8 EEPROM_logReadSlot(const EEPROM_LogType *log,uint8 slot,uint8 *entry,boolean *valid);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
 
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR; 
-		 
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+    /* A page write of one byte */
+    return EEPROM_writePage(u16addr,&u8data,1);
+}
+
+uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
+{
+    /* A sequential read of one byte */
+    return EEPROM_readBlock(u16addr,u8data,1);
+}
+
+uint8 EEPROM_writePage(uint16 u16addr,const uint8 *data,uint8 length)
+{
+    EEPROM_RequestType request;
+
+    if (EEPROM_writePageAsync(&request,u16addr,data,length,NULL_PTR,NULL_PTR) != SUCCESS)
         return ERROR;
-		
-    /* write byte to eeprom */
-    TWI_writeByte(u8data);
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+
+    return EEPROM_wait(&request);
+}
+
+uint8 EEPROM_writeBlock(uint16 u16addr,const uint8 *data,uint16 length)
+{
+    uint8 page_length;
+    uint8 status;
+
+    if((uint32)u16addr + length > EEPROM_SIZE)
         return ERROR;
 
-    /* Send the Stop Bit */
-    TWI_stop();
-	
-    return SUCCESS;
+    while(length != 0)
+    {
+        /* Bytes left in the page of the current address */
+        page_length = EEPROM_PAGE_SIZE - (u16addr % EEPROM_PAGE_SIZE);
+        if(page_length > length)
+        {
+            page_length = (uint8)length;
+        }
+
+        /* Every page waits by ACK polling for the write cycle of the previous one */
+        status = EEPROM_writePage(u16addr,data,page_length);
+        if(status != SUCCESS)
+            return status;
+
+        u16addr += page_length;
+        data += page_length;
+        length -= page_length;
+    }
+
+    /* The block is stored once the write cycle of the last page ends */
+    return EEPROM_waitWriteDone();
 }
 
-uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
+uint8 EEPROM_readBlock(uint16 u16addr,uint8 *data,uint16 length)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
+    EEPROM_RequestType request;
+
+    if (EEPROM_readBlockAsync(&request,u16addr,data,length,NULL_PTR,NULL_PTR) != SUCCESS)
         return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+
+    return EEPROM_wait(&request);
+}
+
+uint8 EEPROM_waitWriteDone(void)
+{
+    EEPROM_RequestType request;
+
+    /* Address probe: the memory acknowledges its address once the write cycle ends */
+    request.transaction.write_length = 0;
+    request.transaction.read_length = 0;
+    request.transaction.address = EEPROM_DEVICE_ADDRESS;
+    request.transaction.write_data = request.buffer;
+    request.transaction.read_data = NULL_PTR;
+    request.transaction.callBack = EEPROM_transactionDone;
+    request.transaction.context = &request;
+    request.retries = 0;
+    request.status = EEPROM_BUSY;
+    request.callBack = NULL_PTR;
+    request.context = NULL_PTR;
+    TWI_submit(&request.transaction);
+
+    return EEPROM_wait(&request);
+}
+
+uint8 EEPROM_writePageAsync(EEPROM_RequestType *request,uint16 u16addr,const uint8 *data,uint8 length,EEPROM_CallBackType a_ptr,void *context)
+{
+    uint8 i;
+
+    /* The memory wraps to the start of the page if the bytes cross its boundary */
+    if((length == 0) || (length > (EEPROM_PAGE_SIZE - (u16addr % EEPROM_PAGE_SIZE))))
         return ERROR;
-		
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+
+    /* The memory location address then the bytes, the memory increments the address after every byte */
+    for(i = 0; i < length; i++)
+    {
+        request->buffer[i + 1] = data[i];
+    }
+
+    EEPROM_submit(request,u16addr,length + 1,NULL_PTR,0,a_ptr,context);
+    return SUCCESS;
+}
+
+uint8 EEPROM_readBlockAsync(EEPROM_RequestType *request,uint16 u16addr,uint8 *data,uint16 length,EEPROM_CallBackType a_ptr,void *context)
+{
+    if((length == 0) || ((uint32)u16addr + length > EEPROM_SIZE))
         return ERROR;
-		
-    /* Send the Repeated Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_REP_START)
+
+    /* Write the memory location address then read the bytes after a repeated start */
+    EEPROM_submit(request,u16addr,1,data,length,a_ptr,context);
+    return SUCCESS;
+}
+
+uint8 EEPROM_wait(EEPROM_RequestType *request)
+{
+    while(request->status == EEPROM_BUSY)
+    {
+        /* The TWI interrupt wakes the CPU */
+        Power_idle();
+    }
+    return request->status;
+}
+
+static void EEPROM_submit(EEPROM_RequestType *request,uint16 u16addr,uint8 write_length,uint8 *read_data,uint16 read_length,EEPROM_CallBackType a_ptr,void *context)
+{
+    /* A8 A9 A10 address bits of the memory location are sent in the device address */
+    request->buffer[0] = (uint8)(u16addr);
+    request->transaction.address = (uint8)(EEPROM_DEVICE_ADDRESS | ((u16addr & 0x0700)>>8));
+    request->transaction.write_data = request->buffer;
+    request->transaction.write_length = write_length;
+    request->transaction.read_data = read_data;
+    request->transaction.read_length = read_length;
+    request->transaction.callBack = EEPROM_transactionDone;
+    request->transaction.context = request;
+    request->retries = 0;
+    request->status = EEPROM_BUSY;
+    request->callBack = a_ptr;
+    request->context = context;
+
+    TWI_submit(&request->transaction);
+}
+
+static void EEPROM_transactionDone(uint8 status,void *context)
+{
+    EEPROM_RequestType *request = (EEPROM_RequestType*)context;
+
+    /* NACK: the memory is still in its internal write cycle, poll again */
+    if((status == TWI_TRANSACTION_SLA_NACK) && (request->retries < EEPROM_ACK_POLL_RETRIES))
+    {
+        request->retries++;
+        TWI_submit(&request->transaction);
+        return;
+    }
+
+    if(status == TWI_TRANSACTION_DONE)
+    {
+        request->status = SUCCESS;
+    }
+    else if(status == TWI_TRANSACTION_SLA_NACK)
+    {
+        request->status = EEPROM_TIMEOUT;
+    }
+    else
+    {
+        request->status = ERROR;
+    }
+
+    if(request->callBack != NULL_PTR)
+    {
+        (*request->callBack)(request->status,request->context);
+    }
+}
+
+uint8 EEPROM_logInit(EEPROM_LogType *log,uint16 start,uint8 slots,uint8 key)
+{
+    uint8 entry[EEPROM_LOG_ENTRY_SIZE];
+    boolean valid;
+    uint16 first_sequence;
+    uint8 low;
+    uint8 high;
+    uint8 mid;
+    uint8 status;
+
+    log->start = start;
+    log->slots = slots;
+    log->key = key;
+    log->head = 0;
+    log->sequence = 0;
+    log->empty = TRUE;
+
+    if((slots == 0) || (start % EEPROM_PAGE_SIZE) || ((uint32)start + ((uint32)slots * EEPROM_LOG_ENTRY_SIZE) > EEPROM_SIZE))
         return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=1 (Read) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
-    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
+
+    status = EEPROM_logReadSlot(log,0,entry,&valid);
+    if(status != SUCCESS)
+        return status;
+
+    if(!valid)
+    {
+        /* Slot 0 is blank or its write was cut: the newest entry is the last slot if the log has wrapped */
+        status = EEPROM_logReadSlot(log,slots - 1,entry,&valid);
+        if(status != SUCCESS)
+            return status;
+        if(valid)
+        {
+            log->head = slots - 1;
+            log->sequence = (uint16)(entry[0] | (entry[1] << 8));
+            log->empty = FALSE;
+        }
+        return SUCCESS;
+    }
+
+    /*
+     * The slots 0 --> head hold consecutive sequences from the one of slot 0, the slots after the head
+     * are blank or older (one round before), so the head is the last slot where
+     * sequence - first_sequence == slot: binary search on [low, high)
+     */
+    first_sequence = (uint16)(entry[0] | (entry[1] << 8));
+    low = 0;
+    high = slots;
+    while((high - low) > 1)
+    {
+        mid = low + ((high - low) / 2);
+        status = EEPROM_logReadSlot(log,mid,entry,&valid);
+        if(status != SUCCESS)
+            return status;
+
+        if(valid && ((uint16)((uint16)(entry[0] | (entry[1] << 8)) - first_sequence) == mid))
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    log->head = low;
+    log->sequence = first_sequence + low;
+    log->empty = FALSE;
+    return SUCCESS;
+}
+
+uint8 EEPROM_logRead(const EEPROM_LogType *log,uint8 *data,uint8 length)
+{
+    uint8 entry[EEPROM_LOG_ENTRY_SIZE];
+    boolean valid;
+    uint8 status;
+    uint8 i;
+
+    if(log->empty)
+        return EEPROM_EMPTY;
+
+    status = EEPROM_logReadSlot(log,log->head,entry,&valid);
+    if(status != SUCCESS)
+        return status;
+    if(!valid)
         return ERROR;
 
-    /* Read Byte from Memory without send ACK */
-    *u8data = TWI_readByteWithNACK();
-    if (TWI_getStatus() != TWI_MR_DATA_NACK)
+    if(length > entry[3])
+    {
+        length = entry[3];
+    }
+    for(i = 0; i < length; i++)
+    {
+        data[i] = entry[4 + i];
+    }
+    return SUCCESS;
+}
+
+uint8 EEPROM_logAppend(EEPROM_LogType *log,const uint8 *data,uint8 length)
+{
+    uint8 entry[EEPROM_LOG_ENTRY_SIZE];
+    uint8 slot;
+    uint16 sequence;
+    uint8 status;
+    uint8 i;
+
+    if(length > EEPROM_LOG_DATA_SIZE)
         return ERROR;
 
-    /* Send the Stop Bit */
-    TWI_stop();
+    /* The next slot round-robin, the first entry goes to slot 0 */
+    if(log->empty)
+    {
+        slot = 0;
+        sequence = 0;
+    }
+    else
+    {
+        slot = (log->head + 1 == log->slots) ? 0 : (log->head + 1);
+        sequence = log->sequence + 1;
+    }
+
+    entry[0] = (uint8)(sequence);
+    entry[1] = (uint8)(sequence >> 8);
+    entry[2] = log->key;
+    entry[3] = length;
+    for(i = 0; i < EEPROM_LOG_DATA_SIZE; i++)
+    {
+        entry[4 + i] = (i < length) ? data[i] : 0xFF;
+    }
+    entry[EEPROM_LOG_ENTRY_SIZE - 1] = CRC8_calculate(entry,EEPROM_LOG_ENTRY_SIZE - 1);
+
+    /* One page write, a cut write leaves a bad CRC and the previous entry stays the newest */
+    status = EEPROM_writeBlock(log->start + ((uint16)slot * EEPROM_LOG_ENTRY_SIZE),entry,EEPROM_LOG_ENTRY_SIZE);
+    if(status != SUCCESS)
+        return status;
+
+    log->head = slot;
+    log->sequence = sequence;
+    log->empty = FALSE;
+    return SUCCESS;
+}
+
+static uint8 EEPROM_logReadSlot(const EEPROM_LogType *log,uint8 slot,uint8 *entry,boolean *valid)
+{
+    uint8 status;
+
+    status = EEPROM_readBlock(log->start + ((uint16)slot * EEPROM_LOG_ENTRY_SIZE),entry,EEPROM_LOG_ENTRY_SIZE);
+    if(status != SUCCESS)
+        return status;
 
+    *valid = (CRC8_calculate(entry,EEPROM_LOG_ENTRY_SIZE - 1) == entry[EEPROM_LOG_ENTRY_SIZE - 1]) &&
+             (entry[2] == log->key) && (entry[3] <= EEPROM_LOG_DATA_SIZE);
     return SUCCESS;
 }
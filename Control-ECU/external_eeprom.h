@@ -15,18 +15,169 @@
 #define EXTERNAL_EEPROM_H_
 
 #include "std_types.h"
+#include "twi.h"
 
 /*******************************************************************************
  *                      Preprocessor Macros                                    *
  *******************************************************************************/
 #define ERROR 0
 #define SUCCESS 1
+#define EEPROM_TIMEOUT 2 /* the memory didn't answer (still busy or absent) */
+#define EEPROM_BUSY 3 /* the request is still queued or running */
+
+/* 7-bit TWI address of the memory, A10 A9 A8 of the memory location are added to it */
+#define EEPROM_DEVICE_ADDRESS          0x50
+
+/* 24C16 memory: 2K bytes organized in 16 bytes pages */
+#define EEPROM_SIZE                    2048
+#define EEPROM_PAGE_SIZE               16
+
+/*
+ * ACK polling: while the memory runs its internal write cycle (10 ms max) it doesn't answer its address,
+ * every transaction resends START + SLA+W until it is acknowledged. One poll takes at least 10 bit times
+ * of TWI_BIT_RATE (100 us at the 100 Kb/s standard mode) so the retries are calculated to cover twice
+ * the write cycle before EEPROM_TIMEOUT is returned (200 polls, at least 20 ms at 100 Kb/s).
+ */
+#define EEPROM_WRITE_CYCLE_MS          10UL
+#define EEPROM_ACK_POLL_BITS           10UL
+#define EEPROM_ACK_POLL_RETRIES        ((2UL * EEPROM_WRITE_CYCLE_MS * TWI_BIT_RATE) / (EEPROM_ACK_POLL_BITS * 1000UL))
+
+#if((EEPROM_ACK_POLL_RETRIES < 1) || (EEPROM_ACK_POLL_RETRIES > 65535))
+
+#error "EEPROM ACK polling retries should be between 1 and 65535"
+
+#endif
+
+/*
+ * Log-structured record store: a region of EEPROM_LOG_ENTRY_SIZE slots (one page each) where every
+ * update of the record is appended to the next slot round-robin so the writes are spread on the region.
+ * | Sequence (2 bytes, little endian) | Key | Length | Data (EEPROM_LOG_DATA_SIZE bytes) | CRC-8 |
+ * The sequence increments with every entry, the CRC-8 covers all the entry bytes before it.
+ */
+#define EEPROM_LOG_ENTRY_SIZE          EEPROM_PAGE_SIZE
+#define EEPROM_LOG_DATA_SIZE           (EEPROM_LOG_ENTRY_SIZE - 5)
+#define EEPROM_EMPTY 4 /* the log has no valid entry */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* Call back function of a request, it is called from the TWI ISR with the request status */
+typedef void (*EEPROM_CallBackType)(uint8 status,void *context);
+
+/*
+ * Asynchronous request, the application owns its memory until the request ends:
+ * 1- The TWI transaction which carries it
+ * 2- The memory location address followed by the page data to write
+ * 3- The ACK polling retries already done
+ * 4- The request status (EEPROM_BUSY until it ends)
+ * 5- The call back function (may be NULL_PTR) and its context pointer
+ */
+typedef struct
+{
+	TWI_TransactionType transaction;
+	uint8 buffer[1 + EEPROM_PAGE_SIZE];
+	uint16 retries;
+	volatile uint8 status;
+	EEPROM_CallBackType callBack;
+	void *context;
+}EEPROM_RequestType;
+
+/*
+ * Log region descriptor:
+ * 1- The region start address (page aligned), its number of slots and the key of its record
+ * 2- The slot and the sequence of the newest entry (found by EEPROM_logInit)
+ * 3- TRUE if the region has no valid entry yet
+ */
+typedef struct
+{
+	uint16 start;
+	uint8 slots;
+	uint8 key;
+	uint8 head;
+	uint16 sequence;
+	boolean empty;
+}EEPROM_LogType;
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
+/*
+ * All the functions return SUCCESS, ERROR (bus error or bad arguments) or EEPROM_TIMEOUT,
+ * every transaction starts by ACK polling so a write returns after its STOP and the next
+ * access waits only for the real write cycle of the memory.
+ * They run on the interrupt driven TWI engine and wait in idle mode, the I-bit must be set.
+ */
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+
+/*
+ * Description :
+ * Write up to EEPROM_PAGE_SIZE bytes in one transaction (one internal write cycle),
+ * the bytes must not cross a page boundary.
+ */
+uint8 EEPROM_writePage(uint16 u16addr,const uint8 *data,uint8 length);
+
+/*
+ * Description :
+ * Write a buffer of any length, it is split on the page boundaries and every page
+ * is written in one transaction (each one waits by ACK polling for the previous write cycle).
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr,const uint8 *data,uint16 length);
+
+/*
+ * Description :
+ * Read a buffer of any length with one sequential read, the address is sent once
+ * then the bytes are streamed (ACK after every byte except the last one).
+ */
+uint8 EEPROM_readBlock(uint16 u16addr,uint8 *data,uint16 length);
+
+/*
+ * Description :
+ * Wait (ACK polling) until the internal write cycle of the last write ends,
+ * to be sure the data is stored before returning SUCCESS to the user.
+ */
+uint8 EEPROM_waitWriteDone(void);
+
+/*
+ * Description :
+ * Queue the write of up to EEPROM_PAGE_SIZE bytes (not crossing a page boundary), the data is copied
+ * in the request so the caller buffer can be reused at once. Returns ERROR for bad arguments else SUCCESS.
+ */
+uint8 EEPROM_writePageAsync(EEPROM_RequestType *request,uint16 u16addr,const uint8 *data,uint8 length,EEPROM_CallBackType a_ptr,void *context);
+
+/*
+ * Description :
+ * Queue a sequential read, the data buffer is filled in the background.
+ * Returns ERROR for bad arguments else SUCCESS.
+ */
+uint8 EEPROM_readBlockAsync(EEPROM_RequestType *request,uint16 u16addr,uint8 *data,uint16 length,EEPROM_CallBackType a_ptr,void *context);
+
+/*
+ * Description :
+ * Wait in idle mode until the request ends and return its status.
+ */
+uint8 EEPROM_wait(EEPROM_RequestType *request);
+
+/*
+ * Description :
+ * Find the newest entry of a log region with a binary search on the slots (log2(slots) + 1 reads),
+ * the region must start on a page boundary. Returns SUCCESS or the EEPROM error.
+ */
+uint8 EEPROM_logInit(EEPROM_LogType *log,uint16 start,uint8 slots,uint8 key);
+
+/*
+ * Description :
+ * Read the data of the newest entry (up to length bytes), returns EEPROM_EMPTY if the log has no entry.
+ */
+uint8 EEPROM_logRead(const EEPROM_LogType *log,uint8 *data,uint8 length);
+
+/*
+ * Description :
+ * Append a new entry (up to EEPROM_LOG_DATA_SIZE bytes) in the slot after the newest one,
+ * it is written in one page write and the function returns once it is stored.
+ */
+uint8 EEPROM_logAppend(EEPROM_LogType *log,const uint8 *data,uint8 length);
  
 #endif /* EXTERNAL_EEPROM_H_ */
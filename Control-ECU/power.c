@@ -0,0 +1,111 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.c
+ *
+ * Description: Source file for the idle sleep wrapper and the current draw estimate
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "power.h"
+#include "Timer.h" /* For the uptime clock */
+#include <avr/io.h> /* To use SREG */
+#include <avr/sleep.h> /* For sleep_cpu() */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Uptime (ms) when the statistics were reset */
+static uint32 g_startMs = 0;
+
+/*
+ * Raw time spent in idle mode (us), the wake path only adds to it,
+ * it is converted to ms or permille by the reporting functions
+ */
+static uint64 g_idleUs = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the power statistics, the uptime clock must be running (Clock_init).
+ */
+void Power_init(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	g_startMs = Clock_nowMs();
+	g_idleUs = 0;
+}
+
+/*
+ * Description :
+ * Put the CPU in idle mode until the next interrupt (the 1ms clock tick at most),
+ * it returns immediately if the global interrupt is disabled as nothing could wake the CPU.
+ */
+void Power_idle(void)
+{
+	uint32 start;
+
+	if(!(SREG & (1<<7)))
+	{
+		return;
+	}
+
+	start = Clock_nowUs();
+
+	/*
+	 * An interrupt served between the caller check and sleep_cpu does not wake the CPU,
+	 * the next one does (the 1ms clock tick at most)
+	 */
+	sleep_enable();
+	sleep_cpu();
+	sleep_disable();
+
+	/* The ISR which woke the CPU is counted as idle time, it is a few us (no division on this path) */
+	g_idleUs += CLOCK_ELAPSED(start,Clock_nowUs());
+}
+
+/*
+ * Description :
+ * Return the ms spent in idle mode since Power_init.
+ */
+uint32 Power_getIdleMs(void)
+{
+	return (uint32)(g_idleUs / 1000);
+}
+
+/*
+ * Description :
+ * Return the ms spent in idle mode for every 1000 ms since Power_init.
+ */
+uint16 Power_getIdlePermille(void)
+{
+	uint32 total = CLOCK_ELAPSED(g_startMs,Clock_nowMs());
+	uint64 permille;
+
+	if(total == 0)
+	{
+		return 0;
+	}
+
+	/* idle us / total ms is already the idle time for every 1000 */
+	permille = g_idleUs / total;
+	return (permille >= 1000) ? 1000 : (uint16)permille;
+}
+
+/*
+ * Description :
+ * Return the estimated average supply current (uA) since Power_init from the idle and active times.
+ */
+uint32 Power_estimateCurrentUa(void)
+{
+	uint32 idle_permille = Power_getIdlePermille();
+
+	return ((POWER_IDLE_CURRENT_UA * idle_permille) + (POWER_ACTIVE_CURRENT_UA * (1000 - idle_permille))) / 1000;
+}
@@ -0,0 +1,71 @@
+ /******************************************************************************
+ *
+ * Module: Power
+ *
+ * File Name: power.h
+ *
+ * Description: Header file for the idle sleep wrapper and the current draw estimate
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * ATmega16 supply current (uA) in active and idle mode at 8Mhz 5V (typical values of the datasheet),
+ * they should be updated with the values measured on the board to get a better estimate.
+ * Idle mode is the only sleep mode used as Timer1 (uptime clock), UART and TWI stop in the deeper modes.
+ */
+#define POWER_ACTIVE_CURRENT_UA        12000UL
+#define POWER_IDLE_CURRENT_UA          5000UL
+
+#if(POWER_IDLE_CURRENT_UA > POWER_ACTIVE_CURRENT_UA)
+
+#error "The idle current should be less than the active current"
+
+#endif
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the power statistics, the uptime clock must be running (Clock_init).
+ */
+void Power_init(void);
+
+/*
+ * Description :
+ * Put the CPU in idle mode until the next interrupt (the 1ms clock tick at most),
+ * it returns immediately if the global interrupt is disabled as nothing could wake the CPU.
+ */
+void Power_idle(void);
+
+/*
+ * Description :
+ * Return the ms spent in idle mode since Power_init.
+ */
+uint32 Power_getIdleMs(void);
+
+/*
+ * Description :
+ * Return the ms spent in idle mode for every 1000 ms since Power_init.
+ */
+uint16 Power_getIdlePermille(void);
+
+/*
+ * Description :
+ * Return the estimated average supply current (uA) since Power_init from the idle and active times.
+ */
+uint32 Power_estimateCurrentUa(void);
+
+#endif /* POWER_H_ */
@@ -0,0 +1,289 @@
+/******************************************************************************
+ *
+ * Module: Software Timers
+ *
+ * File Name: sw_timer.c
+ *
+ * Description: Source file for the software timers (hashed timer wheel) driven by a 1ms Timer1 tick
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "sw_timer.h"
+#include "Timer.h"
+#include "power.h"
+#include <avr/io.h> /* To use SREG */
+#include <avr/interrupt.h> /* For cli() */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+#define SWTIMER_WHEEL_MASK (SWTIMER_WHEEL_SIZE - 1)
+
+/* The wheel: every slot is a list of the timers which may expire when the wheel reaches it */
+static SwTimer_Type *g_wheel[SWTIMER_WHEEL_SIZE];
+
+/* Number of ticks processed by the wheel since SwTimer_init */
+static uint32 g_now = 0;
+
+/* Ticks counted by the Timer1 ISR and not yet consumed by SwTimer_process */
+static volatile uint16 g_pendingTicks = 0;
+
+/* To ignore SwTimer_process calls made from inside a call back function */
+static boolean g_processing = FALSE;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Timer1 call back function */
+static void SwTimer_tick(void);
+
+/* Link the timer in the slot of its expiry tick (now + delay_ms) */
+static void SwTimer_insert(SwTimer_Type *timer,uint32 delay_ms);
+
+/* Unlink the timer from its slot */
+static void SwTimer_unlink(SwTimer_Type *timer);
+
+/* One-shot call back used by SwTimer_delayMs */
+static void SwTimer_setFlag(void *context);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the timer wheel and start the uptime clock which gives its 1ms tick.
+ */
+void SwTimer_init(void)
+{
+	uint8 i;
+
+	for(i = 0;i < SWTIMER_WHEEL_SIZE;i++)
+	{
+		g_wheel[i] = NULL_PTR;
+	}
+	g_now = 0;
+	g_pendingTicks = 0;
+
+	Timer1_setCallBack(SwTimer_tick);
+	Clock_init();
+}
+
+/*
+ * Description :
+ * Start (or restart) a software timer which expires after delay_ms then every period_ms,
+ * period_ms = 0 for a one-shot timer. Insertion is O(1).
+ */
+void SwTimer_start(SwTimer_Type *timer,uint32 delay_ms,uint32 period_ms,SwTimer_CallBackType a_ptr,void *context)
+{
+	SwTimer_stop(timer);
+
+	timer->period_ms = period_ms;
+	timer->callBack = a_ptr;
+	timer->context = context;
+	SwTimer_insert(timer,delay_ms);
+}
+
+/*
+ * Description :
+ * Stop a software timer, it does nothing if the timer is not running. Removal is O(1).
+ */
+void SwTimer_stop(SwTimer_Type *timer)
+{
+	if(timer->active)
+	{
+		SwTimer_unlink(timer);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE while the software timer is running.
+ */
+boolean SwTimer_isActive(const SwTimer_Type *timer)
+{
+	return timer->active;
+}
+
+/*
+ * Description :
+ * Return the ms left before the software timer expires (0 if it is not running).
+ */
+uint32 SwTimer_remainingMs(const SwTimer_Type *timer)
+{
+	if(!timer->active)
+	{
+		return 0;
+	}
+	return (timer->expiry - g_now) * SWTIMER_TICK_MS;
+}
+
+/*
+ * Description :
+ * Advance the wheel by the ticks elapsed since the last call and call the call back
+ * functions of the expired timers, it must be called from the main loop and from the busy waits.
+ */
+void SwTimer_process(void)
+{
+	SwTimer_Type *timer;
+	SwTimer_Type *next;
+	uint16 ticks;
+	uint8 sreg;
+
+	if(g_processing)
+	{
+		return;
+	}
+	g_processing = TRUE;
+
+	/* Take the pending ticks with the interrupts masked */
+	sreg = SREG;
+	cli();
+	ticks = g_pendingTicks;
+	g_pendingTicks = 0;
+	SREG = sreg;
+
+	while(ticks != 0)
+	{
+		ticks--;
+		g_now++;
+
+		/* Only the timers hashed to this slot can expire now, the others are a full wheel turn (or more) away */
+		timer = g_wheel[g_now & SWTIMER_WHEEL_MASK];
+		while(timer != NULL_PTR)
+		{
+			next = timer->next;
+			if(timer->expiry == g_now)
+			{
+				SwTimer_unlink(timer);
+				if(timer->period_ms != 0)
+				{
+					SwTimer_insert(timer,timer->period_ms);
+				}
+				if(timer->callBack != NULL_PTR)
+				{
+					/*
+					 * The call back may start or stop any timer, including the next one of this slot,
+					 * so restart from the slot head (the timers which already expired are not in it any more)
+					 */
+					(*timer->callBack)(timer->context);
+					next = g_wheel[g_now & SWTIMER_WHEEL_MASK];
+				}
+			}
+			timer = next;
+		}
+	}
+
+	g_processing = FALSE;
+}
+
+/*
+ * Description :
+ * Wait the required ms while the other software timers keep running, the CPU is in idle mode between the ticks,
+ * returns TRUE once the delay is done or FALSE without waiting if it is called from a call back function.
+ */
+boolean SwTimer_delayMs(uint32 delay_ms)
+{
+	SwTimer_Type s_delay_timer = {NULL_PTR};
+	volatile boolean expired = FALSE;
+
+	/*
+	 * From a call back function the wheel is not advanced (SwTimer_process returns at once)
+	 * so the delay would never end, it is refused and the caller is told it didn't wait
+	 */
+	if(g_processing)
+	{
+		return FALSE;
+	}
+
+	SwTimer_start(&s_delay_timer,delay_ms,0,SwTimer_setFlag,(void*)&expired);
+	while(1)
+	{
+		SwTimer_process();
+		if(expired)
+		{
+			break;
+		}
+		/* Sleep until the next tick */
+		Power_idle();
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Timer1 call back function, it only counts the ticks and SwTimer_process does the work.
+ */
+static void SwTimer_tick(void)
+{
+	if(g_pendingTicks != 0xFFFF)
+	{
+		g_pendingTicks++;
+	}
+}
+
+/*
+ * Description :
+ * Link the timer in the slot of its expiry tick (now + delay_ms), the slot is visited
+ * every SWTIMER_WHEEL_SIZE ticks and the timer expires the time its expiry tick is reached.
+ */
+static void SwTimer_insert(SwTimer_Type *timer,uint32 delay_ms)
+{
+	uint32 ticks = delay_ms / SWTIMER_TICK_MS;
+
+	if(ticks == 0)
+	{
+		ticks = 1;
+	}
+
+	timer->expiry = g_now + ticks;
+	timer->slot = (uint8)(timer->expiry & SWTIMER_WHEEL_MASK);
+
+	/* Insert at the head of the slot list */
+	timer->prev = NULL_PTR;
+	timer->next = g_wheel[timer->slot];
+	if(timer->next != NULL_PTR)
+	{
+		timer->next->prev = timer;
+	}
+	g_wheel[timer->slot] = timer;
+	timer->active = TRUE;
+}
+
+/*
+ * Description :
+ * Unlink the timer from its slot.
+ */
+static void SwTimer_unlink(SwTimer_Type *timer)
+{
+	if(timer->prev != NULL_PTR)
+	{
+		timer->prev->next = timer->next;
+	}
+	else
+	{
+		g_wheel[timer->slot] = timer->next;
+	}
+
+	if(timer->next != NULL_PTR)
+	{
+		timer->next->prev = timer->prev;
+	}
+
+	timer->next = NULL_PTR;
+	timer->prev = NULL_PTR;
+	timer->active = FALSE;
+}
+
+/*
+ * Description :
+ * One-shot call back used by SwTimer_delayMs.
+ */
+static void SwTimer_setFlag(void *context)
+{
+	*(volatile boolean*)context = TRUE;
+}
@@ -0,0 +1,26 @@
+ /******************************************************************************
+ *
+ * Module: Host test fakes
+ *
+ * File Name: interrupt.h
+ *
+ * Description: Fake interrupt macros for the host tests, an ISR is a plain function the test calls
+ * to raise the interrupt, cli/sei change the I-bit of the fake SREG and cli calls are counted.
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef FAKE_AVR_INTERRUPT_H_
+#define FAKE_AVR_INTERRUPT_H_
+
+#include "avr/io.h"
+
+/* Number of cli() calls (critical sections entered) */
+extern unsigned int g_fakeCliCount;
+
+#define ISR(VECTOR)  void VECTOR(void); void VECTOR(void)
+#define cli()        (g_fakeCliCount++, SREG &= (uint8_t)~(1<<7))
+#define sei()        (SREG |= (1<<7))
+
+#endif /* FAKE_AVR_INTERRUPT_H_ */
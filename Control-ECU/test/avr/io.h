@@ -0,0 +1,71 @@
+ /******************************************************************************
+ *
+ * Module: Host test fakes
+ *
+ * File Name: io.h
+ *
+ * Description: Fake ATmega16 registers for the host tests (plain variables defined by the test),
+ * only the registers and bits used by the drivers under test are declared.
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef FAKE_AVR_IO_H_
+#define FAKE_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t SREG;
+
+/* Timers */
+extern volatile uint8_t TCCR0,TCNT0,OCR0,TIMSK,TIFR,TCCR1A,TCCR1B,TCCR2,TCNT2,OCR2;
+extern volatile uint16_t TCNT1,OCR1A;
+
+/* USART */
+extern volatile uint8_t UCSRA,UCSRB,UCSRC,UBRRH,UBRRL,UDR;
+
+/* TCCR0 */
+#define FOC0   7
+#define WGM01  3
+/* TCCR1A - TCCR1B */
+#define FOC1A  3
+#define FOC1B  2
+#define WGM12  3
+/* TCCR2 */
+#define FOC2   7
+#define WGM21  3
+/* TIMSK */
+#define OCIE2  7
+#define TOIE2  6
+#define TICIE1 5
+#define OCIE1A 4
+#define OCIE1B 3
+#define TOIE1  2
+#define OCIE0  1
+#define TOIE0  0
+/* TIFR */
+#define OCF1A  4
+/* UCSRA */
+#define RXC    7
+#define TXC    6
+#define UDRE   5
+#define FE     4
+#define DOR    3
+#define PE     2
+#define U2X    1
+#define MPCM   0
+/* UCSRB */
+#define RXCIE  7
+#define TXCIE  6
+#define UDRIE  5
+#define RXEN   4
+#define TXEN   3
+#define UCSZ2  2
+#define RXB8   1
+#define TXB8   0
+/* UCSRC */
+#define URSEL  7
+#define USBS   3
+
+#endif /* FAKE_AVR_IO_H_ */
@@ -0,0 +1,229 @@
+ /******************************************************************************
+ *
+ * Module: Credential (host test)
+ *
+ * File Name: test_credential.c
+ *
+ * Description: Host test of the password slot selection (A/B slots with a generation byte),
+ * the external EEPROM is replaced by a RAM array which can cut the writes like a reset.
+ *
+ * Build and run on the PC from the Control-ECU folder:
+ * gcc -std=gnu99 -Wall -DF_CPU=8000000UL -I. test/test_credential.c credential.c crc.c -o test_credential && ./test_credential
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "credential.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* RAM copy of the external EEPROM (erased) */
+static uint8 g_memory[EEPROM_SIZE];
+
+/* Number of writes which are done before the next ones fail (the reset), negative for no limit */
+static int g_writesLeft = -1;
+
+static int g_failures = 0;
+
+#define CHECK(CONDITION) \
+	do \
+	{ \
+		if(!(CONDITION)) \
+		{ \
+			printf("FAIL %s:%d: %s\n",__FILE__,__LINE__,#CONDITION); \
+			g_failures++; \
+		} \
+	}while(0)
+
+/*******************************************************************************
+ *                      Fake EEPROM driver                                     *
+ *******************************************************************************/
+
+uint8 EEPROM_readBlock(uint16 u16addr,uint8 *data,uint16 length)
+{
+	memcpy(data,&g_memory[u16addr],length);
+	return SUCCESS;
+}
+
+uint8 EEPROM_writeBlock(uint16 u16addr,const uint8 *data,uint16 length)
+{
+	if(g_writesLeft == 0)
+	{
+		return EEPROM_TIMEOUT;
+	}
+	if(g_writesLeft > 0)
+	{
+		g_writesLeft--;
+	}
+	memcpy(&g_memory[u16addr],data,length);
+	return SUCCESS;
+}
+
+/*******************************************************************************
+ *                      Test helpers                                           *
+ *******************************************************************************/
+
+static void erase(void)
+{
+	memset(g_memory,0xFF,sizeof(g_memory));
+	g_writesLeft = -1;
+	Credential_init();
+}
+
+static void makePassword(uint8 *password,uint16 value)
+{
+	uint8 i;
+
+	for(i = 0;i < CREDENTIAL_PASSWORD_LENGTH;i++)
+	{
+		password[i] = '0' + (value % 10);
+		value /= 10;
+	}
+}
+
+/*******************************************************************************
+ *                      Tests                                                  *
+ *******************************************************************************/
+
+static void test_selectSlot(void)
+{
+	/* Both valid: the newest generation, also across the 255 --> 0 wrap */
+	CHECK(Credential_selectSlot(TRUE,7,TRUE,8) == 1);
+	CHECK(Credential_selectSlot(TRUE,8,TRUE,7) == 0);
+	CHECK(Credential_selectSlot(TRUE,255,TRUE,0) == 1);
+	CHECK(Credential_selectSlot(TRUE,0,TRUE,255) == 0);
+
+	/* One slot torn: the other one whatever the generations are */
+	CHECK(Credential_selectSlot(TRUE,3,FALSE,4) == 0);
+	CHECK(Credential_selectSlot(FALSE,4,TRUE,3) == 1);
+
+	/* Both invalid */
+	CHECK(Credential_selectSlot(FALSE,0,FALSE,1) == CREDENTIAL_NO_SLOT);
+}
+
+static void test_generationWrap(void)
+{
+	uint8 password[CREDENTIAL_PASSWORD_LENGTH];
+	uint16 i;
+
+	erase();
+
+	/* More than 256 changes, the last password must be loaded after every reset */
+	for(i = 0;i < 300;i++)
+	{
+		makePassword(password,i);
+		CHECK(Credential_store(password) == SUCCESS);
+
+		Credential_init();
+		CHECK(Credential_isProvisioned());
+		CHECK(Credential_match(password));
+	}
+}
+
+static void test_tornSlot(void)
+{
+	uint8 first[CREDENTIAL_PASSWORD_LENGTH];
+	uint8 second[CREDENTIAL_PASSWORD_LENGTH];
+
+	erase();
+	makePassword(first,11111);
+	makePassword(second,22222);
+	CHECK(Credential_store(first) == SUCCESS);   /* slot A */
+	CHECK(Credential_store(second) == SUCCESS);  /* slot B */
+
+	/* The newest slot is torn: the previous password is loaded */
+	g_memory[CREDENTIAL_SLOT_B_LOCATION + 2] ^= 0x01;
+	Credential_init();
+	CHECK(Credential_isProvisioned());
+	CHECK(Credential_match(first));
+	CHECK(!Credential_match(second));
+}
+
+static void test_bothInvalid(void)
+{
+	uint8 password[CREDENTIAL_PASSWORD_LENGTH];
+
+	erase();
+	makePassword(password,12345);
+	CHECK(Credential_store(password) == SUCCESS);
+	CHECK(Credential_store(password) == SUCCESS);
+
+	/* Both slots torn (or zeroed): no password, the first time setup runs again */
+	g_memory[CREDENTIAL_SLOT_A_LOCATION + CREDENTIAL_PASSWORD_LENGTH + 1] ^= 0x80;
+	memset(&g_memory[CREDENTIAL_SLOT_B_LOCATION],0x00,CREDENTIAL_RECORD_LENGTH);
+	Credential_init();
+	CHECK(!Credential_isValid());
+	CHECK(!Credential_isProvisioned());
+	CHECK(!Credential_match(password));
+}
+
+static void test_resetBeforeHeader(void)
+{
+	uint8 password[CREDENTIAL_PASSWORD_LENGTH];
+
+	erase();
+	makePassword(password,54321);
+
+	/* The first password is written then the reset comes before the header write */
+	g_writesLeft = 1;
+	CHECK(Credential_store(password) != SUCCESS);
+	g_writesLeft = -1;
+
+	/* The password is there but the unit is not provisioned: the setup is repeated */
+	Credential_init();
+	CHECK(Credential_isValid());
+	CHECK(!Credential_isProvisioned());
+
+	/* The repeated setup writes the header */
+	CHECK(Credential_store(password) == SUCCESS);
+	Credential_init();
+	CHECK(Credential_isProvisioned());
+	CHECK(Credential_match(password));
+}
+
+static void test_resetDuringChange(void)
+{
+	uint8 current[CREDENTIAL_PASSWORD_LENGTH];
+	uint8 next[CREDENTIAL_PASSWORD_LENGTH];
+
+	erase();
+	makePassword(current,10101);
+	makePassword(next,20202);
+	CHECK(Credential_store(current) == SUCCESS);
+
+	/* The slot write of the new password is cut: the current password is kept */
+	g_writesLeft = 0;
+	CHECK(Credential_store(next) != SUCCESS);
+	CHECK(Credential_match(current));
+	g_writesLeft = -1;
+
+	Credential_init();
+	CHECK(Credential_isProvisioned());
+	CHECK(Credential_match(current));
+	CHECK(!Credential_match(next));
+}
+
+int main(void)
+{
+	test_selectSlot();
+	test_generationWrap();
+	test_tornSlot();
+	test_bothInvalid();
+	test_resetBeforeHeader();
+	test_resetDuringChange();
+
+	if(g_failures != 0)
+	{
+		printf("%d check(s) failed\n",g_failures);
+		return 1;
+	}
+
+	printf("All credential tests passed\n");
+	return 0;
+}
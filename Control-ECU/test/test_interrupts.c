@@ -0,0 +1,294 @@
+ /******************************************************************************
+ *
+ * Module: Timer - UART (host test)
+ *
+ * File Name: test_interrupts.c
+ *
+ * Description: Host test of the interrupt ownership of the Timer and UART drivers,
+ * the registers are fake variables (test/avr/io.h) so the test checks that Timer_init and
+ * Timer_DeInit change only the TIMSK bits of their timer, never change the I-bit and restore
+ * SREG after their critical sections, and that no received byte is lost across a door cycle.
+ *
+ * Build and run on the PC from the Control-ECU folder:
+ * gcc -std=gnu99 -Wall -DF_CPU=8000000UL -Itest -I. test/test_interrupts.c Timer.c uart.c -o test_interrupts && ./test_interrupts
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include "Timer.h"
+#include "uart.h"
+#include "avr/io.h"
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Fake registers */
+volatile uint8_t SREG;
+volatile uint8_t TCCR0,TCNT0,OCR0,TIMSK,TIFR,TCCR1A,TCCR1B,TCCR2,TCNT2,OCR2;
+volatile uint16_t TCNT1,OCR1A;
+volatile uint8_t UCSRA,UCSRB,UCSRC,UBRRH,UBRRL,UDR;
+
+unsigned int g_fakeCliCount = 0;
+
+/* The ISRs of the drivers under test */
+void USART_RXC_vect(void);
+void TIMER1_COMPA_vect(void);
+
+/* TIMSK bits owned by each timer */
+static const uint8 g_timerBits[3] =
+{
+	(1<<TOIE0) | (1<<OCIE0),
+	(1<<TOIE1) | (1<<OCIE1A),
+	(1<<TOIE2) | (1<<OCIE2)
+};
+
+/* Next byte sent by the other ECU and next byte expected by the application */
+static uint8 g_txByte = 0;
+static uint8 g_rxByte = 0;
+
+static int g_failures = 0;
+
+#define CHECK(CONDITION) \
+	do \
+	{ \
+		if(!(CONDITION)) \
+		{ \
+			printf("FAIL %s:%d: %s\n",__FILE__,__LINE__,#CONDITION); \
+			g_failures++; \
+		} \
+	}while(0)
+
+/*******************************************************************************
+ *                      Fake hardware                                          *
+ *******************************************************************************/
+
+/*
+ * A byte is received by the USART: it waits in UDR (RXC set) until the RXC ISR reads it,
+ * if UDR is still full the byte is lost and DOR is set like the real receiver.
+ */
+static void fake_receive(uint8 data)
+{
+	if(UCSRA & (1<<RXC))
+	{
+		UCSRA |= (1<<DOR);
+	}
+	else
+	{
+		UDR = data;
+		UCSRA |= (1<<RXC);
+	}
+}
+
+/*
+ * Serve the pending RX interrupt if the I-bit and RXCIE allow it, the I-bit is cleared
+ * while the ISR runs and reading UDR clears RXC and DOR.
+ */
+static void fake_serveInterrupts(void)
+{
+	if((SREG & (1<<7)) && (UCSRB & (1<<RXCIE)) && (UCSRA & (1<<RXC)))
+	{
+		SREG &= (uint8)~(1<<7);
+		USART_RXC_vect();
+		UCSRA &= (uint8)~((1<<RXC) | (1<<DOR));
+		SREG |= (1<<7);
+	}
+}
+
+/*******************************************************************************
+ *                      Test helpers                                           *
+ *******************************************************************************/
+
+static void startLink(void)
+{
+	UART_ConfigType s_uart_config = {Eight_bits,Disabled,one_bit,Double_Speed_mode,UART_LINK_UBRR};
+	uint8 data;
+
+	UCSRA = 0;
+	UCSRB = 0;
+	TIMSK = 0;
+	UART_init(&s_uart_config);
+	while(UART_tryReceive(&data));
+	g_txByte = 0;
+	g_rxByte = 0;
+	sei();
+}
+
+/* The other ECU sends one byte then the pending interrupt is served */
+static void receiveNext(void)
+{
+	fake_receive(g_txByte++);
+	fake_serveInterrupts();
+}
+
+/* The application reads every received byte, they must come in order */
+static void drain(void)
+{
+	uint8 data;
+
+	while(UART_tryReceive(&data))
+	{
+		CHECK(data == g_rxByte);
+		g_rxByte++;
+	}
+}
+
+/*
+ * Call Timer_init then Timer_DeInit for one timer and mode starting from the required TIMSK and
+ * I-bit, only the timer bits may change and SREG must be the same after each call.
+ */
+static void checkTimer(Timer_Number timer_id,Timer_Modes mode,uint8 timsk,uint8 sreg)
+{
+	Timer_ConfigType s_config = {timer_id,mode,F_CPU_8,f_cpu_8,0,100};
+	uint8 own_bit;
+	unsigned int cli_count;
+
+	if(timer_id == Timer0)
+	{
+		own_bit = (mode == NormalMode) ? (1<<TOIE0) : (1<<OCIE0);
+	}
+	else if(timer_id == Timer1)
+	{
+		own_bit = (mode == NormalMode) ? (1<<TOIE1) : (1<<OCIE1A);
+	}
+	else
+	{
+		own_bit = (mode == NormalMode) ? (1<<TOIE2) : (1<<OCIE2);
+	}
+
+	TIMSK = timsk;
+	SREG = sreg;
+	cli_count = g_fakeCliCount;
+	Timer_init(&s_config);
+	CHECK(SREG == sreg);
+	CHECK(g_fakeCliCount > cli_count);
+	CHECK(TIMSK == (timsk | own_bit));
+
+	cli_count = g_fakeCliCount;
+	Timer_DeInit(timer_id);
+	CHECK(SREG == sreg);
+	CHECK(g_fakeCliCount > cli_count);
+	CHECK(TIMSK == (timsk & (uint8)~g_timerBits[timer_id]));
+}
+
+/*******************************************************************************
+ *                      Tests                                                  *
+ *******************************************************************************/
+
+static void test_timerOwnership(void)
+{
+	static const uint8 s_sreg[2] = {0x00,0x80};
+	uint8 timer_id;
+	uint8 mode;
+	uint8 i;
+
+	for(timer_id = Timer0;timer_id <= Timer2;timer_id++)
+	{
+		for(mode = NormalMode;mode <= Compare_mode;mode++)
+		{
+			for(i = 0;i < 2;i++)
+			{
+				/* The other timers enabled, then nothing enabled */
+				checkTimer(timer_id,mode,(uint8)~g_timerBits[timer_id],s_sreg[i]);
+				checkTimer(timer_id,mode,0x00,s_sreg[i]);
+				/* The other SREG flags are kept too */
+				checkTimer(timer_id,mode,(uint8)~g_timerBits[timer_id],s_sreg[i] | 0x03);
+			}
+		}
+	}
+}
+
+static void test_doorCycle(void)
+{
+	Timer_ConfigType s_timer0_config = {Timer0,Compare_mode,F_CPU_8,no_clock,0,250};
+	Timer_ConfigType s_timer2_config = {Timer2,NormalMode,No_Clock,f_cpu_8,0,0};
+	uint8 phase;
+	uint16 tick;
+
+	startLink();
+	Clock_init();
+	receiveNext();
+
+	/* Opening, hold and closing: a timer is started and stopped in every phase while the
+	 * Clock keeps ticking and the HMI keeps sending */
+	for(phase = 0;phase < 3;phase++)
+	{
+		Timer_init(&s_timer0_config);
+		receiveNext();
+		Timer_init(&s_timer2_config);
+		receiveNext();
+
+		for(tick = 0;tick < 100;tick++)
+		{
+			TIMER1_COMPA_vect();
+			receiveNext();
+			if((tick % 8) == 0)
+			{
+				drain();
+			}
+		}
+
+		Timer_DeInit(Timer2);
+		receiveNext();
+		Timer_DeInit(Timer0);
+		receiveNext();
+		drain();
+	}
+
+	/* The bytes received after the last Timer_DeInit must be served too */
+	receiveNext();
+	receiveNext();
+	drain();
+
+	CHECK(g_rxByte == g_txByte);
+	CHECK(UART_getRxOverflowCount() == 0);
+	CHECK(SREG & (1<<7));
+	CHECK((TIMSK & (1<<OCIE1A)) != 0);
+	CHECK((TIMSK & (g_timerBits[Timer0] | g_timerBits[Timer2])) == 0);
+	Timer_DeInit(Timer1);
+}
+
+static void test_rxOverflow(void)
+{
+	uint16 count;
+	uint8 i;
+
+	startLink();
+	count = UART_getRxOverflowCount();
+
+	/* The ring buffer keeps UART_RX_BUFFER_SIZE - 1 bytes, the next ones are counted as lost */
+	for(i = 0;i < UART_RX_BUFFER_SIZE + 2;i++)
+	{
+		receiveNext();
+	}
+	CHECK(UART_getRxOverflowCount() == count + 3);
+
+	/* A byte which is not served before the next one arrives is lost in the hardware (DOR) */
+	startLink();
+	count = UART_getRxOverflowCount();
+	cli();
+	fake_receive(1);
+	fake_receive(2);
+	sei();
+	fake_serveInterrupts();
+	CHECK(UART_getRxOverflowCount() == count + 1);
+}
+
+int main(void)
+{
+	test_timerOwnership();
+	test_doorCycle();
+	test_rxOverflow();
+
+	if(g_failures != 0)
+	{
+		printf("%d check(s) failed\n",g_failures);
+		return 1;
+	}
+
+	printf("All interrupt tests passed\n");
+	return 0;
+}
@@ -13,15 +13,152 @@
 #include "twi.h"
 #include "common_macros.h"
 #include <avr/io.h>
+#include <avr/interrupt.h> /* For TWI ISR */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Queue of the transactions, the head is the running one */
+static TWI_TransactionType *volatile g_queueHead = NULL_PTR;
+static TWI_TransactionType *volatile g_queueTail = NULL_PTR;
+
+/* TRUE from the start of a transaction until the queue is empty */
+static volatile boolean g_busy = FALSE;
+
+/* Bytes written and read of the running transaction, and its phase (SLA+W/data or SLA+R/data) */
+static uint8 g_writeIndex = 0;
+static uint16 g_readIndex = 0;
+static boolean g_readPhase = FALSE;
+
+/* TWCR values of the engine, the TWI interrupt is enabled while a transaction runs */
+#define TWI_ENGINE_START   ((1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE))
+#define TWI_ENGINE_NEXT    ((1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+#define TWI_ENGINE_ACK     ((1<<TWINT) | (1<<TWEA) | (1<<TWEN) | (1<<TWIE))
+#define TWI_ENGINE_STOP    ((1<<TWINT) | (1<<TWSTO) | (1<<TWEN))
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Reset the indexes for the transaction at the head of the queue */
+static void TWI_prepareHead(void);
+
+/* End the running transaction, call its call back function and start the next queued one */
+static void TWI_finish(uint8 status);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/*
+ * The master state machine of the running transaction, every step is started by
+ * writing TWCR and the next TWI interrupt gives its status code.
+ */
+ISR(TWI_vect)
+{
+	TWI_TransactionType *transaction = g_queueHead;
+
+	switch(TWI_getStatus())
+	{
+		case TWI_START:
+		case TWI_REP_START:
+			/* Send the slave address with R/W=0 (write) or R/W=1 (read) */
+			TWDR = (uint8)((transaction->address << 1) | (g_readPhase ? 1 : 0));
+			TWCR = TWI_ENGINE_NEXT;
+			break;
+
+		case TWI_MT_SLA_W_ACK:
+		case TWI_MT_DATA_ACK:
+			if(g_writeIndex < transaction->write_length)
+			{
+				/* Send the next byte */
+				TWDR = transaction->write_data[g_writeIndex];
+				g_writeIndex++;
+				TWCR = TWI_ENGINE_NEXT;
+			}
+			else if(transaction->read_length != 0)
+			{
+				/* All the bytes are written, send a repeated start to read */
+				g_readPhase = TRUE;
+				TWCR = TWI_ENGINE_START;
+			}
+			else
+			{
+				TWI_finish(TWI_TRANSACTION_DONE);
+			}
+			break;
+
+		case TWI_MT_SLA_R_ACK:
+			/* Receive the first byte, ACK it unless it is the last one */
+			TWCR = (transaction->read_length > 1) ? TWI_ENGINE_ACK : TWI_ENGINE_NEXT;
+			break;
+
+		case TWI_MR_DATA_ACK:
+			transaction->read_data[g_readIndex] = TWDR;
+			g_readIndex++;
+			TWCR = ((transaction->read_length - g_readIndex) > 1) ? TWI_ENGINE_ACK : TWI_ENGINE_NEXT;
+			break;
+
+		case TWI_MR_DATA_NACK:
+			/* The last byte */
+			transaction->read_data[g_readIndex] = TWDR;
+			g_readIndex++;
+			TWI_finish(TWI_TRANSACTION_DONE);
+			break;
+
+		case TWI_MT_SLA_W_NACK:
+		case TWI_MT_SLA_R_NACK:
+			TWI_finish(TWI_TRANSACTION_SLA_NACK);
+			break;
+
+		default:
+			/* Data NACK, arbitration lost or bus error */
+			TWI_finish(TWI_TRANSACTION_ERROR);
+			break;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
 
 void TWI_init(const TWI_ConfigType* TWI_Config)
 {
-    /* Bit Rate: Dynamically Configured using (TWI_Config-> TWI_bit_rate)
-     * pre-scaler : Dynamically Configured using (TWI_Config-> prescalar)
+	uint32 cycles = TWI_CYCLES_PER_BIT(TWI_Config->TWI_bit_rate);
+	uint32 twbr = TWI_MIN_TWBR;
+	uint32 divider;
+	uint8 twps;
+
+    /* Bit Rate: SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+     * the smallest pre-scaler (best resolution) which gives TWBR <= 255 is used,
+     * TWBR is rounded up so the bus never runs faster than TWI_bit_rate
      */
-	TWSR = 0X00;
-	TWBR = TWBR = (unsigned char)( (1/2) * ((F_CPU / TWI_Config-> TWI_bit_rate) - 16UL));
-	//TWBR = TWBR = (unsigned char)( ((double)1/((1 << (2*(TWI_Config->prescalar) +1) ))) * ((8000000 / TWI_Config-> TWI_bit_rate) - 16UL));
+	for(twps = 0; twps < 4; twps++)
+	{
+		divider = 2UL << (2 * twps);
+		if(cycles > 16)
+		{
+			twbr = ((cycles - 16) + divider - 1) / divider;
+		}
+		if(twbr <= 255)
+		{
+			break;
+		}
+	}
+	if(twps == 4)
+	{
+		/* Too slow, use the slowest bit rate */
+		twps = 3;
+		twbr = 255;
+	}
+	if(twbr < TWI_MIN_TWBR)
+	{
+		twbr = TWI_MIN_TWBR;
+	}
+
+	TWSR = twps;
+	TWBR = (uint8)twbr;
 
     /* Two Wire Bus address my address if any master device want to call me (used in case this MC is a slave device)
        General Call Recognition: Off
@@ -101,3 +238,94 @@ uint8 TWI_getStatus(void)
     status = TWSR & 0xF8;
     return status;
 }
+
+/*
+ * Description :
+ * Queue a transaction for the interrupt driven engine, it returns immediately and the
+ * whole status-code state machine runs in the TWI ISR (the I-bit must be set).
+ * The blocking functions above must not be used while a transaction is queued.
+ */
+void TWI_submit(TWI_TransactionType *transaction)
+{
+	uint8 sreg = SREG;
+
+	transaction->next = NULL_PTR;
+	transaction->status = TWI_TRANSACTION_PENDING;
+
+	cli();
+	if(g_queueTail == NULL_PTR)
+	{
+		g_queueHead = transaction;
+	}
+	else
+	{
+		g_queueTail->next = transaction;
+	}
+	g_queueTail = transaction;
+
+	/* Start it if the engine is idle, else the ISR starts it after the running ones */
+	if(!g_busy)
+	{
+		g_busy = TRUE;
+		TWI_prepareHead();
+
+		/* Wait for the STOP of the last transaction to be sent */
+		while(BIT_IS_SET(TWCR,TWSTO));
+		TWCR = TWI_ENGINE_START;
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Return TRUE while queued transactions are running.
+ */
+boolean TWI_isBusy(void)
+{
+	return g_busy;
+}
+
+/*
+ * Description :
+ * Reset the indexes for the transaction at the head of the queue,
+ * a read only transaction starts directly with SLA+R.
+ */
+static void TWI_prepareHead(void)
+{
+	g_writeIndex = 0;
+	g_readIndex = 0;
+	g_readPhase = (g_queueHead->write_length == 0) && (g_queueHead->read_length != 0);
+}
+
+/*
+ * Description :
+ * End the running transaction, call its call back function (it may submit other transactions)
+ * then send STOP, or STOP followed by START if another transaction is queued.
+ */
+static void TWI_finish(uint8 status)
+{
+	TWI_TransactionType *transaction = g_queueHead;
+
+	g_queueHead = transaction->next;
+	if(g_queueHead == NULL_PTR)
+	{
+		g_queueTail = NULL_PTR;
+	}
+
+	transaction->status = status;
+	if(transaction->callBack != NULL_PTR)
+	{
+		(*transaction->callBack)(status,transaction->context);
+	}
+
+	if(g_queueHead != NULL_PTR)
+	{
+		TWI_prepareHead();
+		TWCR = TWI_ENGINE_STOP | (1<<TWSTA) | (1<<TWIE);
+	}
+	else
+	{
+		g_busy = FALSE;
+		TWCR = TWI_ENGINE_STOP;
+	}
+}
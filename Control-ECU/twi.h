@@ -23,32 +23,85 @@
 #define TWI_START         0x08 /* start has been sent */
 #define TWI_REP_START     0x10 /* repeated start */
 #define TWI_MT_SLA_W_ACK  0x18 /* Master transmit ( slave address + Write request ) to slave + ACK received from slave. */
+#define TWI_MT_SLA_W_NACK 0x20 /* Master transmit ( slave address + Write request ) to slave + NACK received from slave (busy or absent). */
 #define TWI_MT_SLA_R_ACK  0x40 /* Master transmit ( slave address + Read request ) to slave + ACK received from slave. */
 #define TWI_MT_DATA_ACK   0x28 /* Master transmit data and ACK has been received from Slave. */
 #define TWI_MR_DATA_ACK   0x50 /* Master received data and send ACK to slave. */
 #define TWI_MR_DATA_NACK  0x58 /* Master received data but doesn't send ACK to slave. */
+#define TWI_MT_DATA_NACK  0x30 /* Master transmit data and NACK has been received from Slave. */
+#define TWI_ARB_LOST      0x38 /* Arbitration lost in SLA+R/W or data bytes. */
+#define TWI_MT_SLA_R_NACK 0x48 /* Master transmit ( slave address + Read request ) to slave + NACK received from slave. */
+
+/*
+ * Bit rate profiles and the bit rate used by the application, SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ * TWBR should be 10 or higher in Master mode (datasheet) so the fast mode needs F_CPU >= 14.4Mhz
+ */
+#define TWI_STANDARD_MODE_BIT_RATE     100000UL
+#define TWI_FAST_MODE_BIT_RATE         400000UL
+#define TWI_BIT_RATE                   TWI_STANDARD_MODE_BIT_RATE
+#define TWI_MIN_TWBR                   10
+
+/* CPU cycles of one SCL period (rounded up so the bus never runs faster than required) */
+#define TWI_CYCLES_PER_BIT(RATE)       ((F_CPU + (RATE) - 1) / (RATE))
+
+#if(TWI_BIT_RATE > TWI_FAST_MODE_BIT_RATE)
+
+#error "TWI bit rate should be 400 Kb/s or less"
+
+#elif(TWI_CYCLES_PER_BIT(TWI_BIT_RATE) < (16 + (2 * TWI_MIN_TWBR)))
+
+#error "TWI bit rate can't be reached with this F_CPU (TWBR would be less than 10)"
+
+#elif(TWI_CYCLES_PER_BIT(TWI_BIT_RATE) > (16 + (2 * 255 * 64)))
+
+#error "TWI bit rate is too low for this F_CPU (TWBR would be more than 255 with prescaler 64)"
+
+#endif
+
+/* Status of a queued transaction (TWI_TransactionType) */
+#define TWI_TRANSACTION_PENDING    0 /* queued or running */
+#define TWI_TRANSACTION_DONE       1 /* all the bytes are written and read */
+#define TWI_TRANSACTION_SLA_NACK   2 /* the slave didn't acknowledge its address (busy or absent) */
+#define TWI_TRANSACTION_ERROR      3 /* data NACK, arbitration lost or bus error */
 
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
-/* TWI Prescalar values*/
-typedef enum
-{
-	CPU_CLOCK,F_CPU_4,F_CPU_16,F_CPU_64
-}TWI_Prescalar;
-
 /* Configuration Structure for TWI Driver Which configure:
- 1- TWI bit rate (100 Kb/s or 400 Kb/s or 1Mb/s or 3.4Mb/s)
+ 1- TWI bit rate (TWI_STANDARD_MODE_BIT_RATE or TWI_FAST_MODE_BIT_RATE), TWBR and the prescaler are solved from it
  2- The Address of the device we will work with.
- 3- TWI Prescalar
 */
 typedef struct
 {
 	 uint32 TWI_bit_rate;
 	 uint8 my_address;
-	 TWI_Prescalar prescalar;
 }TWI_ConfigType;
 
+/* Call back function of a transaction, it is called from the TWI ISR with the transaction status */
+typedef void (*TWI_CallBackType)(uint8 status,void *context);
+
+/*
+ * Transaction descriptor, the application owns its memory until the call back function is called:
+ * 1- The link to the next queued transaction (used by the driver)
+ * 2- The 7-bit slave address
+ * 3- The bytes to write then the buffer of the bytes to read after a repeated start
+ *    (write only: read_length = 0 - read only: write_length = 0 - none: address probe)
+ * 4- The transaction status (TWI_TRANSACTION_PENDING until it ends)
+ * 5- The call back function (may be NULL_PTR) and its context pointer
+ */
+typedef struct TWI_Transaction
+{
+	struct TWI_Transaction *next;
+	uint8 address;
+	const uint8 *write_data;
+	uint8 write_length;
+	uint8 *read_data;
+	uint16 read_length;
+	volatile uint8 status;
+	TWI_CallBackType callBack;
+	void *context;
+}TWI_TransactionType;
+
 
 
 /*******************************************************************************
@@ -62,5 +115,19 @@ uint8 TWI_readByteWithACK(void);
 uint8 TWI_readByteWithNACK(void);
 uint8 TWI_getStatus(void);
 
+/*
+ * Description :
+ * Queue a transaction for the interrupt driven engine, it returns immediately and the
+ * whole status-code state machine runs in the TWI ISR (the I-bit must be set).
+ * The blocking functions above must not be used while a transaction is queued.
+ */
+void TWI_submit(TWI_TransactionType *transaction);
+
+/*
+ * Description :
+ * Return TRUE while queued transactions are running.
+ */
+boolean TWI_isBusy(void);
+
 
 #endif /* TWI_H_ */
@@ -0,0 +1,499 @@
+ /******************************************************************************
+ *
+ * Module: User Table
+ *
+ * File Name: user_table.c
+ *
+ * Description: Source file for the staff codes table (open-addressed hash table in the external EEPROM)
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "user_table.h"
+#include "crc.h"
+
+/*******************************************************************************
+ *                           Private Definitions                               *
+ *******************************************************************************/
+
+/* FNV-1a 32-bit parameters */
+#define USER_TABLE_FNV_OFFSET          2166136261UL
+#define USER_TABLE_FNV_PRIME           16777619UL
+
+/* Seed of the second hash (code check), any value other than the FNV offset */
+#define USER_TABLE_CHECK_OFFSET        0x5BD1E995UL
+
+/* Bucket field offsets */
+#define USER_TABLE_STATE_INDEX         0
+#define USER_TABLE_ID_INDEX            1
+#define USER_TABLE_HASH_INDEX          2
+#define USER_TABLE_FLAGS_INDEX         6
+#define USER_TABLE_CHECK_INDEX         7
+#define USER_TABLE_CRC_INDEX           (USER_TABLE_BUCKET_SIZE - 1)
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Number of users in the table, it lets the lookup be skipped while the table is empty */
+static uint8 g_userCount = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* FNV-1a hash of a code starting from the required offset */
+static uint32 UserTable_hashCode(const uint8 *code,uint32 offset);
+
+/* Read a bucket, *used is TRUE if it holds a user with a valid CRC */
+static uint8 UserTable_readBucket(uint8 bucket,uint8 *data,boolean *used);
+
+/* Write the state byte of a bucket and wait until it is stored */
+static uint8 UserTable_writeState(uint8 bucket,uint8 state);
+
+/* Reclaim the deleted buckets in place */
+static uint8 UserTable_rebuild(void);
+
+/* Convert between the bucket bytes and the user record */
+static void UserTable_decode(const uint8 *data,UserTable_UserType *user);
+static void UserTable_encode(const UserTable_UserType *user,uint8 *data);
+
+/* Little endian 32-bit fields */
+static uint32 UserTable_getUint32(const uint8 *data);
+static void UserTable_putUint32(uint8 *data,uint32 value);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Count the users of the table once at boot (full scan), the count is then kept up to date by add and revoke,
+ * returns SUCCESS or the EEPROM error.
+ */
+uint8 UserTable_init(void)
+{
+	uint8 data[USER_TABLE_BUCKET_SIZE];
+	boolean used;
+	uint8 bucket;
+	uint8 status;
+
+	g_userCount = 0;
+	for(bucket = 0;bucket < USER_TABLE_BUCKETS;bucket++)
+	{
+		status = UserTable_readBucket(bucket,data,&used);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+
+		if(used)
+		{
+			g_userCount++;
+		}
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Return the number of users in the table (no EEPROM access).
+ */
+uint8 UserTable_count(void)
+{
+	return g_userCount;
+}
+
+/*
+ * Description :
+ * Find the user of the required code, the bucket reads don't depend on the table size,
+ * returns SUCCESS, USER_TABLE_NOT_FOUND or the EEPROM error.
+ */
+uint8 UserTable_find(const uint8 *code,UserTable_UserType *user)
+{
+	uint8 data[USER_TABLE_BUCKET_SIZE];
+	uint32 hash = UserTable_hashCode(code,USER_TABLE_FNV_OFFSET);
+	uint32 check;
+	uint8 bucket = (uint8)(hash & (USER_TABLE_BUCKETS - 1));
+	boolean used;
+	uint8 status;
+	uint8 i;
+
+	/* No EEPROM read while there is no user */
+	if(g_userCount == 0)
+	{
+		return USER_TABLE_NOT_FOUND;
+	}
+	check = UserTable_hashCode(code,USER_TABLE_CHECK_OFFSET);
+
+	/* Linear probing, an empty bucket ends the chain (deleted buckets don't) */
+	for(i = 0;i < USER_TABLE_BUCKETS;i++)
+	{
+		status = UserTable_readBucket(bucket,data,&used);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+
+		if(data[USER_TABLE_STATE_INDEX] == USER_TABLE_EMPTY)
+		{
+			break;
+		}
+
+		if(used && (UserTable_getUint32(&data[USER_TABLE_HASH_INDEX]) == hash) &&
+				(UserTable_getUint32(&data[USER_TABLE_CHECK_INDEX]) == check))
+		{
+			UserTable_decode(data,user);
+			return SUCCESS;
+		}
+
+		bucket = (bucket + 1) & (USER_TABLE_BUCKETS - 1);
+	}
+
+	return USER_TABLE_NOT_FOUND;
+}
+
+/*
+ * Description :
+ * Return TRUE if the user has the required flag.
+ */
+boolean UserTable_isAllowed(const UserTable_UserType *user,uint8 flag)
+{
+	return ((user->flags & flag) == flag);
+}
+
+/*
+ * Description :
+ * Add a user with its code (the code_hash field of the user is ignored), the user ID and the code must be new,
+ * returns SUCCESS, USER_TABLE_EXISTS, USER_TABLE_FULL or the EEPROM error.
+ */
+uint8 UserTable_add(const UserTable_UserType *user,const uint8 *code)
+{
+	uint8 data[USER_TABLE_BUCKET_SIZE];
+	UserTable_UserType record;
+	boolean used;
+	uint8 users = 0;
+	uint8 deleted = 0;
+	uint8 bucket;
+	uint8 status;
+	uint8 i;
+
+	/* The code must be new (one lookup) */
+	status = UserTable_find(code,&record);
+	if(status == SUCCESS)
+	{
+		return USER_TABLE_EXISTS;
+	}
+	else if(status != USER_TABLE_NOT_FOUND)
+	{
+		return status;
+	}
+
+	/* The ID must be new and the table must have a free bucket below the load limit (full scan, admin only) */
+	for(bucket = 0;bucket < USER_TABLE_BUCKETS;bucket++)
+	{
+		status = UserTable_readBucket(bucket,data,&used);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+
+		if(used)
+		{
+			if(data[USER_TABLE_ID_INDEX] == user->id)
+			{
+				return USER_TABLE_EXISTS;
+			}
+			users++;
+		}
+		else if(data[USER_TABLE_STATE_INDEX] != USER_TABLE_EMPTY)
+		{
+			/* Deleted (or cut write) bucket, it doesn't end a probe chain */
+			deleted++;
+		}
+	}
+
+	if(users >= USER_TABLE_MAX_USERS)
+	{
+		return USER_TABLE_FULL;
+	}
+
+	/* The deleted buckets count in the load limit, past it they are reclaimed */
+	if((users + deleted) >= USER_TABLE_MAX_USERS)
+	{
+		status = UserTable_rebuild();
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+	}
+
+	record = *user;
+	record.code_hash = UserTable_hashCode(code,USER_TABLE_FNV_OFFSET);
+	record.code_check = UserTable_hashCode(code,USER_TABLE_CHECK_OFFSET);
+
+	/* The first bucket of the probe chain which doesn't hold a user (deleted buckets are reused) */
+	bucket = (uint8)(record.code_hash & (USER_TABLE_BUCKETS - 1));
+	for(i = 0;i < USER_TABLE_BUCKETS;i++)
+	{
+		status = UserTable_readBucket(bucket,data,&used);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+
+		if(!used)
+		{
+			/* One page write, a cut write leaves a bad CRC which is seen as a free bucket */
+			UserTable_encode(&record,data);
+			status = EEPROM_writeBlock(USER_TABLE_LOCATION + ((uint16)bucket * USER_TABLE_BUCKET_SIZE),data,USER_TABLE_BUCKET_SIZE);
+			if(status == SUCCESS)
+			{
+				g_userCount = users + 1;
+			}
+			return status;
+		}
+
+		bucket = (bucket + 1) & (USER_TABLE_BUCKETS - 1);
+	}
+
+	return USER_TABLE_FULL;
+}
+
+/*
+ * Description :
+ * Revoke the user of the required ID (its buckets are marked deleted),
+ * returns SUCCESS, USER_TABLE_NOT_FOUND or the EEPROM error.
+ */
+uint8 UserTable_revoke(uint8 id)
+{
+	uint8 data[USER_TABLE_BUCKET_SIZE];
+	boolean used;
+	uint8 bucket;
+	uint8 status = USER_TABLE_NOT_FOUND;
+	uint8 result;
+
+	/*
+	 * The table is indexed by the code so the ID needs a full scan (admin only),
+	 * the scan doesn't stop at the first user as a reset during a rebuild can leave two copies of it
+	 */
+	for(bucket = 0;bucket < USER_TABLE_BUCKETS;bucket++)
+	{
+		result = UserTable_readBucket(bucket,data,&used);
+		if(result != SUCCESS)
+		{
+			return result;
+		}
+
+		if(used && (data[USER_TABLE_ID_INDEX] == id))
+		{
+			/* Only the state byte is written, the bucket keeps the probe chain going */
+			status = UserTable_writeState(bucket,USER_TABLE_DELETED);
+			if(status != SUCCESS)
+			{
+				return status;
+			}
+			if(g_userCount > 0)
+			{
+				g_userCount--;
+			}
+		}
+	}
+
+	return status;
+}
+
+/*
+ * Description :
+ * FNV-1a hash of a code starting from the required offset.
+ */
+static uint32 UserTable_hashCode(const uint8 *code,uint32 offset)
+{
+	uint32 hash = offset;
+	uint8 i;
+
+	for(i = 0;i < USER_TABLE_CODE_LENGTH;i++)
+	{
+		hash ^= code[i];
+		hash *= USER_TABLE_FNV_PRIME;
+	}
+	return hash;
+}
+
+/*
+ * Description :
+ * Read a bucket, *used is TRUE if it holds a user with a valid CRC.
+ */
+static uint8 UserTable_readBucket(uint8 bucket,uint8 *data,boolean *used)
+{
+	uint8 status;
+
+	status = EEPROM_readBlock(USER_TABLE_LOCATION + ((uint16)bucket * USER_TABLE_BUCKET_SIZE),data,USER_TABLE_BUCKET_SIZE);
+	if(status != SUCCESS)
+	{
+		return status;
+	}
+
+	*used = (data[USER_TABLE_STATE_INDEX] == USER_TABLE_USED) &&
+			(CRC8_calculate(data,USER_TABLE_CRC_INDEX) == data[USER_TABLE_CRC_INDEX]);
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Write the state byte of a bucket and wait until it is stored.
+ */
+static uint8 UserTable_writeState(uint8 bucket,uint8 state)
+{
+	uint8 status;
+
+	status = EEPROM_writeByte(USER_TABLE_LOCATION + ((uint16)bucket * USER_TABLE_BUCKET_SIZE),state);
+	if(status == SUCCESS)
+	{
+		status = EEPROM_waitWriteDone();
+	}
+	return status;
+}
+
+/*
+ * Description :
+ * Reclaim the deleted buckets in place (there is no spare EEPROM area and no RAM for a copy of the table):
+ * 1- Every user with a free bucket in its probe chain (between its home bucket and its bucket) is moved to
+ *    the first one, the copy is stored before the old bucket is marked deleted so a reset never loses a user.
+ *    Each move brings a user closer to its home bucket so the passes end.
+ * 2- No probe chain goes through a deleted bucket anymore, so they are all erased (one state byte each).
+ */
+static uint8 UserTable_rebuild(void)
+{
+	uint8 data[USER_TABLE_BUCKET_SIZE];
+	uint8 probe[USER_TABLE_BUCKET_SIZE];
+	boolean used;
+	boolean moved;
+	uint8 bucket;
+	uint8 target;
+	uint8 status;
+
+	do
+	{
+		moved = FALSE;
+		for(bucket = 0;bucket < USER_TABLE_BUCKETS;bucket++)
+		{
+			status = UserTable_readBucket(bucket,data,&used);
+			if(status != SUCCESS)
+			{
+				return status;
+			}
+			if(!used)
+			{
+				continue;
+			}
+
+			/* The first bucket of the probe chain which doesn't hold a user */
+			target = (uint8)(UserTable_getUint32(&data[USER_TABLE_HASH_INDEX]) & (USER_TABLE_BUCKETS - 1));
+			while(target != bucket)
+			{
+				status = UserTable_readBucket(target,probe,&used);
+				if(status != SUCCESS)
+				{
+					return status;
+				}
+				if(!used)
+				{
+					break;
+				}
+				target = (target + 1) & (USER_TABLE_BUCKETS - 1);
+			}
+
+			if(target != bucket)
+			{
+				status = EEPROM_writeBlock(USER_TABLE_LOCATION + ((uint16)target * USER_TABLE_BUCKET_SIZE),data,USER_TABLE_BUCKET_SIZE);
+				if(status == SUCCESS)
+				{
+					status = EEPROM_waitWriteDone();
+				}
+				if(status == SUCCESS)
+				{
+					status = UserTable_writeState(bucket,USER_TABLE_DELETED);
+				}
+				if(status != SUCCESS)
+				{
+					return status;
+				}
+				moved = TRUE;
+			}
+		}
+	}while(moved);
+
+	for(bucket = 0;bucket < USER_TABLE_BUCKETS;bucket++)
+	{
+		status = UserTable_readBucket(bucket,data,&used);
+		if(status != SUCCESS)
+		{
+			return status;
+		}
+		if(!used && (data[USER_TABLE_STATE_INDEX] != USER_TABLE_EMPTY))
+		{
+			status = UserTable_writeState(bucket,USER_TABLE_EMPTY);
+			if(status != SUCCESS)
+			{
+				return status;
+			}
+		}
+	}
+
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Convert the bucket bytes to a user record.
+ */
+static void UserTable_decode(const uint8 *data,UserTable_UserType *user)
+{
+	user->id = data[USER_TABLE_ID_INDEX];
+	user->code_hash = UserTable_getUint32(&data[USER_TABLE_HASH_INDEX]);
+	user->code_check = UserTable_getUint32(&data[USER_TABLE_CHECK_INDEX]);
+	user->flags = data[USER_TABLE_FLAGS_INDEX];
+}
+
+/*
+ * Description :
+ * Convert a user record to the bucket bytes (with its state and CRC).
+ */
+static void UserTable_encode(const UserTable_UserType *user,uint8 *data)
+{
+	uint8 i;
+
+	data[USER_TABLE_STATE_INDEX] = USER_TABLE_USED;
+	data[USER_TABLE_ID_INDEX] = user->id;
+	UserTable_putUint32(&data[USER_TABLE_HASH_INDEX],user->code_hash);
+	data[USER_TABLE_FLAGS_INDEX] = user->flags;
+	UserTable_putUint32(&data[USER_TABLE_CHECK_INDEX],user->code_check);
+	for(i = USER_TABLE_CHECK_INDEX + 4;i < USER_TABLE_CRC_INDEX;i++)
+	{
+		data[i] = 0xFF;
+	}
+	data[USER_TABLE_CRC_INDEX] = CRC8_calculate(data,USER_TABLE_CRC_INDEX);
+}
+
+/*
+ * Description :
+ * Read a little endian 32-bit field.
+ */
+static uint32 UserTable_getUint32(const uint8 *data)
+{
+	return ((uint32)data[0]) | ((uint32)data[1] << 8) | ((uint32)data[2] << 16) | ((uint32)data[3] << 24);
+}
+
+/*
+ * Description :
+ * Write a little endian 32-bit field.
+ */
+static void UserTable_putUint32(uint8 *data,uint32 value)
+{
+	data[0] = (uint8)(value);
+	data[1] = (uint8)(value >> 8);
+	data[2] = (uint8)(value >> 16);
+	data[3] = (uint8)(value >> 24);
+}
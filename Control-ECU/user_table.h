@@ -0,0 +1,129 @@
+ /******************************************************************************
+ *
+ * Module: User Table
+ *
+ * File Name: user_table.h
+ *
+ * Description: Header file for the staff codes table (open-addressed hash table in the external EEPROM)
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef USER_TABLE_H_
+#define USER_TABLE_H_
+
+#include "std_types.h"
+#include "external_eeprom.h"
+#include "credential.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The table is USER_TABLE_BUCKETS buckets of one page each, a code is hashed (FNV-1a) to the bucket
+ * hash % USER_TABLE_BUCKETS then the next buckets are probed until the code or an empty bucket is found.
+ * The number of users is limited to 3/4 of the buckets so a lookup needs few bucket reads,
+ * the deleted buckets lengthen the probe chains too so they count in this limit: once the users and the
+ * deleted buckets reach it the table is rebuilt in place before the next add (the deleted buckets are reclaimed).
+ * | State | User ID | Code Hash (4 bytes) | Flags | Code Check (4 bytes) | Unused | CRC-8 |
+ * The code check is a second hash of the code with another seed, a code matches only if both are equal
+ * so two codes with the same hash can't open as each other.
+ * The multi-byte fields are little endian, the CRC-8 covers all the bucket bytes before it.
+ * The users have no validity window: the board has no RTC and the uptime is not a date.
+ */
+#define USER_TABLE_LOCATION            0x400
+#define USER_TABLE_BUCKETS             64
+#define USER_TABLE_BUCKET_SIZE         EEPROM_PAGE_SIZE
+#define USER_TABLE_MAX_USERS           ((USER_TABLE_BUCKETS * 3) / 4)
+#define USER_TABLE_CODE_LENGTH         CREDENTIAL_PASSWORD_LENGTH
+
+#if((USER_TABLE_BUCKETS < 2) || (USER_TABLE_BUCKETS > 128) || (USER_TABLE_BUCKETS & (USER_TABLE_BUCKETS - 1)))
+
+#error "Number of buckets should be a power of two between 2 and 128"
+
+#endif
+
+#if((USER_TABLE_LOCATION % EEPROM_PAGE_SIZE) || ((USER_TABLE_LOCATION + (USER_TABLE_BUCKETS * USER_TABLE_BUCKET_SIZE)) > EEPROM_SIZE))
+
+#error "User table should start on a page boundary and fit in the EEPROM"
+
+#endif
+
+/* Bucket states, an erased bucket is empty, a revoked user leaves a deleted bucket to keep the probe chains */
+#define USER_TABLE_EMPTY               0xFF
+#define USER_TABLE_USED                0xA5
+#define USER_TABLE_DELETED             0x00
+
+/* User flags */
+#define USER_FLAG_OPEN_DOOR            0x01
+#define USER_FLAG_ADMIN                0x02
+
+/* Status of the table operations (besides SUCCESS and the EEPROM errors) */
+#define USER_TABLE_NOT_FOUND           0x10
+#define USER_TABLE_FULL                0x11
+#define USER_TABLE_EXISTS              0x12
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/*
+ * User record:
+ * 1- The user ID and the two hashes of the user code (the code itself is not saved)
+ * 2- The user flags (USER_FLAG_OPEN_DOOR - USER_FLAG_ADMIN)
+ */
+typedef struct
+{
+	uint8 id;
+	uint32 code_hash;
+	uint32 code_check;
+	uint8 flags;
+}UserTable_UserType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Count the users of the table once at boot (full scan), the count is then kept up to date by add and revoke,
+ * returns SUCCESS or the EEPROM error.
+ */
+uint8 UserTable_init(void);
+
+/*
+ * Description :
+ * Return the number of users in the table (no EEPROM access).
+ */
+uint8 UserTable_count(void);
+
+/*
+ * Description :
+ * Find the user of the required code, the bucket reads don't depend on the table size,
+ * returns SUCCESS, USER_TABLE_NOT_FOUND or the EEPROM error.
+ */
+uint8 UserTable_find(const uint8 *code,UserTable_UserType *user);
+
+/*
+ * Description :
+ * Return TRUE if the user has the required flag.
+ */
+boolean UserTable_isAllowed(const UserTable_UserType *user,uint8 flag);
+
+/*
+ * Description :
+ * Add a user with its code (the code hash and check of the user are ignored), the user ID and the code must be new,
+ * the table is rebuilt first if the users and the deleted buckets reach the load limit, returns SUCCESS, USER_TABLE_EXISTS, USER_TABLE_FULL or the EEPROM error.
+ */
+uint8 UserTable_add(const UserTable_UserType *user,const uint8 *code);
+
+/*
+ * Description :
+ * Revoke the user of the required ID (its buckets are marked deleted),
+ * returns SUCCESS, USER_TABLE_NOT_FOUND or the EEPROM error.
+ */
+uint8 UserTable_revoke(uint8 id);
+
+#endif /* USER_TABLE_H_ */
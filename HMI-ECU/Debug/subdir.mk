@@ -6,25 +6,37 @@
 C_SRCS += \
 ../HMI_ECU.c \
 ../Timer.c \
+../crc.c \
 ../gpio.c \
 ../keypad.c \
 ../lcd.c \
+../power.c \
+../protocol.c \
+../sw_timer.c \
 ../uart.c 
 
 OBJS += \
 ./HMI_ECU.o \
 ./Timer.o \
+./crc.o \
 ./gpio.o \
 ./keypad.o \
 ./lcd.o \
+./power.o \
+./protocol.o \
+./sw_timer.o \
 ./uart.o 
 
 C_DEPS += \
 ./HMI_ECU.d \
 ./Timer.d \
+./crc.d \
 ./gpio.d \
 ./keypad.d \
 ./lcd.d \
+./power.d \
+./protocol.d \
+./sw_timer.d \
 ./uart.d 
 
 
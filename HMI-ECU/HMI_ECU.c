@@ -12,17 +12,46 @@
 #include "HMI_ECU.h"
 #include "timer.h"
 #include "uart.h"
+#include "protocol.h"
+#include "sw_timer.h"
+#include "power.h"
 #include "timer.h"
 #include <avr/io.h> /* to enable the global interrupt*/
+#include <avr/pgmspace.h> /* the UI strings are in the program memory */
 #include <util/delay.h>
 /*******************************************************************************
  *                                global variables                            *
  *******************************************************************************/
-/* flag to know when the timer finish counting*/
-uint8 timer_flag=0;
 /* Contains the status of the passwords sent by control ECU*/
 uint8 status;
 
+/* UI strings, they stay in the program memory (no SRAM copy at startup) */
+static const char g_msgEnterPassword[] PROGMEM = "Please Enter The Password";
+static const char g_msgReEnterPassword[] PROGMEM = "Please Re-Enter The Password";
+static const char g_msgOpenDoorMenu[] PROGMEM = "(+): Open Door";
+static const char g_msgChangePasswordMenu[] PROGMEM = "(-): Change Password";
+static const char g_msgCorrectPassword[] PROGMEM = "Correct Password";
+static const char g_msgPasswordsDismatch[] PROGMEM = "In Correct Password";
+static const char g_msgEnterCurrentPassword[] PROGMEM = "Please Enter Password : ";
+static const char g_msgDoorOpening[] PROGMEM = "Door is Opening...";
+static const char g_msgDoorClosing[] PROGMEM = "closing The Door";
+static const char g_msgWrongPassword[] PROGMEM = "Wrong Password !";
+static const char g_msgThief[] PROGMEM = "Thief !!!!!!!";
+static const char g_msgChangingPassword[] PROGMEM = "Changing The Password....";
+static const char g_msgIncorrectPassword[] PROGMEM = "Incorrect Password !";
+static const char g_msgError[] PROGMEM = "ERROR !";
+static const char g_msgDoorKeys[] PROGMEM = "=:+5s  *:Close";
+static const char g_msgDoorBusy[] PROGMEM = "Door is Busy";
+
+/* UI strings table in the program memory, it is indexed by HMI_MessageType */
+static const char * const g_messages[] PROGMEM =
+{
+	g_msgEnterPassword,g_msgReEnterPassword,g_msgOpenDoorMenu,g_msgChangePasswordMenu,
+	g_msgCorrectPassword,g_msgPasswordsDismatch,g_msgEnterCurrentPassword,g_msgDoorOpening,
+	g_msgDoorClosing,g_msgWrongPassword,g_msgThief,g_msgChangingPassword,g_msgIncorrectPassword,g_msgError,
+	g_msgDoorKeys,g_msgDoorBusy
+};
+
 /*******************************************************************************
  *                              Functions Definitions                           *
  *******************************************************************************/
@@ -37,35 +66,27 @@ void HMI_Adjust_And_Display_Password(uint8* password){
 		/* get The Pressed Key into The Password Buffer */
 		password[i] = KEYPAD_getPressedKey();
 
-		/* Display '*' on the screen */
-		LCD_moveCursor(1,i+12);
+		/* Display '*' on the screen (only this cell is sent to the LCD) */
+		LCD_moveCursor(1,i+PASSWORD_ECHO_COLUMN);
 		LCD_displayCharacter('*');
+		LCD_flush();
 
 		/* This delay to give chance to take the pressed key in the next iteration */
-		_delay_ms(500);
+		SwTimer_delayMs(500);
 	}
 	/* Polling Untill Enter Key is Pressed */
 	while( KEYPAD_getPressedKey() != Enter_Key){}
-	_delay_ms(500);
+	SwTimer_delayMs(500);
 }
 /*************************************************************************************/
 
 /*
- * Description : this function send the password to control ECU if it is ready to receive
+ * Description : this function send the password to control ECU in one frame
  */
 void Send_Password_To_ControlECU(const uint8* password)
 {
-	/* Send dummy byte to tell controlECU that HMI ECU is ready */
-	UART_sendByte(HMI_ECU_READY);
-
-	 /* Wait until Control ECU reply that it is ready to receive password */
-	 while(UART_recieveByte()!= CONTROL_ECU_READY);
-
-	/* Send password to control ECU by UART driver byte by byte */
-	for(uint8 i  = 0;i <PASSWORD_LENGTH;i ++)
-	{
-		UART_sendByte(password[i]);
-	}
+	/* Send the whole password to control ECU in one frame */
+	PROTOCOL_sendFrame(PROTOCOL_MSG_CREDENTIAL,password,PASSWORD_LENGTH);
 }
 
 /**************************************************************************************/
@@ -78,20 +99,17 @@ void Send_Password_To_ControlECU(const uint8* password)
 void Display_EnterPassword(uint8* first_password,uint8* second_password)
 {
 	/* Take first password */
-	LCD_clearScreen();
-	LCD_moveCursor(0,3);
-	LCD_displayString((uint8*)"Please Enter The Password");
+	displayMessage(3,MSG_ENTER_PASSWORD);
 	/* Display '*' on the screen*/
 	HMI_Adjust_And_Display_Password(first_password);
 
 
 	/* Take first password */
-	LCD_clearScreen();
-	LCD_moveCursor(0,3);
-	LCD_displayString((uint8*)"Please Re-Enter The Password");
+	displayMessage(3,MSG_REENTER_PASSWORD);
 	/* Display '*' on the screen*/
 	HMI_Adjust_And_Display_Password(second_password);
 	LCD_clearScreen();
+	LCD_flush();
 
 	/* Send Passwords to control ECU */
 	Send_Password_To_ControlECU(first_password);
@@ -105,11 +123,20 @@ void Display_EnterPassword(uint8* first_password,uint8* second_password)
  */
 void displayUserOptions(void){
 	LCD_clearScreen();
-	LCD_moveCursor(0,4);
-	LCD_displayString((uint8*)"(+): Open Door");
+	LCD_displayStringRowColumn_P(0,4,(const char*)pgm_read_word(&g_messages[MSG_OPEN_DOOR_MENU]));
+	LCD_displayStringRowColumn_P(1,4,(const char*)pgm_read_word(&g_messages[MSG_CHANGE_PASSWORD_MENU]));
+	LCD_flush();
+}
 
-	LCD_moveCursor(1,4);
-	LCD_displayString((uint8*)"(-): Change Password");
+/**************************************************************************************/
+/*
+ * Description : display a one line message on a clear screen, only the cells which differ
+ * from the current screen are sent to the LCD
+ */
+void displayMessage(uint8 col,HMI_MessageType message){
+	LCD_clearScreen();
+	LCD_displayStringRowColumn_P(0,col,(const char*)pgm_read_word(&g_messages[message]));
+	LCD_flush();
 }
 /**************************************************************************************/
 /*
@@ -128,19 +155,15 @@ void Display_EnterPassword_AndCheckStatus(uint8* first_password,uint8* second_pa
 
 		if(status == PASSWORD_MATCH)
 		{
-			LCD_clearScreen();
-			LCD_moveCursor(0,4);
-			LCD_displayString((uint8*)"Correct Password");
-			_delay_ms(500);
+			displayMessage(4,MSG_CORRECT_PASSWORD);
+			SwTimer_delayMs(500);
 			break;
 		}
 		else
 		{
 			/* Stay in While loop if 2 Passwords doesn't match */
-			LCD_clearScreen();
-			LCD_moveCursor(0,4);
-			LCD_displayString((uint8*)"In Correct Password");
-			_delay_ms(500);
+			displayMessage(4,MSG_PASSWORDS_DISMATCH);
+			SwTimer_delayMs(500);
 		}
 	}
 }
@@ -166,11 +189,9 @@ void UserOptions(uint8* a_first_password,uint8* a_second_password){
 			{
 
 			/* Ask user to enter the password */
-			LCD_clearScreen();
-			LCD_moveCursor(0,4);
-			LCD_displayString((uint8*)"Please Enter Password : ");
+			displayMessage(4,MSG_ENTER_CURRENT_PASSWORD);
 
-			_delay_ms(200);
+			SwTimer_delayMs(200);
 			/* Display '*' on the screen */
 			HMI_Adjust_And_Display_Password(a_first_password);
 
@@ -183,45 +204,27 @@ void UserOptions(uint8* a_first_password,uint8* a_second_password){
 			/* Check on the status comes from Control ECU*/
 	/*-->*/		if(status == DOOR_IS_OPENING )
 			{
-				LCD_clearScreen();
-
-				/* Opening The door as The password Matched */
-				LCD_clearScreen();
-				LCD_moveCursor(0,4);
-				LCD_displayString((uint8*)"Door is Opening...");
-
-				/* Waiting Control ECU To decide when we close the door */
-				status = recievePasswordStatus();
-
-				/* If the status sent by control ECU is CLOSING_DOOR */
-				if(status == DOOR_IS_CLOSING)
-				{
-					LCD_clearScreen();
-
-					/* The door is closing*/
-					LCD_clearScreen();
-					LCD_moveCursor(0,4);
-					LCD_displayString((uint8*)"closing The Door");
-
-					/* Wait Until The door is closed to return to main menu*/
-					status = recievePasswordStatus();
-					break;
-				}
+				/* Opening The door as The password Matched, wait Until The door is closed to return to main menu */
+				waitDoorCycle();
+				break;
+			}
+	/*-->*/		else if(status == DOOR_IS_BUSY)
+			{
+				/* the door cycle is still running, the option is refused */
+				displayMessage(4,MSG_DOOR_BUSY);
+				SwTimer_delayMs(500);
+				break;
 			}
 	/*-->*/		else if(status == PASSWORD_DISMATCH)
 				{
-				LCD_clearScreen();
-				LCD_moveCursor(0,4);
-				LCD_displayString((uint8*)"Wrong Password !");
-				_delay_ms(500);
+				displayMessage(4,MSG_WRONG_PASSWORD);
+				SwTimer_delayMs(500);
 				/* no break as if the password is wrong for 3 times ,Alarm will turn on */
 				}
 
 				else if(status == ERROR_MESSAGE)
 				{
-				LCD_clearScreen();
-				LCD_moveCursor(0,4);
-				LCD_displayString((uint8*)"Thief !!!!!!!");
+				displayMessage(4,MSG_THIEF);
 				recievePasswordStatus();/*to wait until receive continue program status*/
 				/*to display the main menu again*/
 				break;
@@ -235,10 +238,8 @@ void UserOptions(uint8* a_first_password,uint8* a_second_password){
 			{
 
 				/* Tell the user to enter the old password*/
-				LCD_clearScreen();
-				LCD_moveCursor(0,4);
-				LCD_displayString((uint8*)"Please Enter password : ");
-				_delay_ms(200);
+				displayMessage(4,MSG_ENTER_CURRENT_PASSWORD);
+				SwTimer_delayMs(200);
 
 				/* Take the password from the user and display '*' */
 				HMI_Adjust_And_Display_Password(a_first_password);
@@ -251,29 +252,31 @@ void UserOptions(uint8* a_first_password,uint8* a_second_password){
 
 				if(status == PASSWORD_MATCH)
 				{
-					LCD_clearScreen();
-					LCD_moveCursor(0,4);
-					LCD_displayString((uint8*)"Changing The Password....");
-					_delay_ms(1000);
+					displayMessage(4,MSG_CHANGING_PASSWORD);
+					SwTimer_delayMs(1000);
 					/* Check The Entered Password */
 					Display_EnterPassword_AndCheckStatus(a_first_password,a_second_password);
 					break;
 				}
 
+				else if(status == DOOR_IS_BUSY)
+				{
+					/* the door cycle is still running, the option is refused */
+					displayMessage(4,MSG_DOOR_BUSY);
+					SwTimer_delayMs(500);
+					break;
+				}
+
 				else if(status == PASSWORD_DISMATCH)
 				{
-					LCD_clearScreen();
-					LCD_moveCursor(0,4);
-					LCD_displayString((uint8*)"Incorrect Password !");
-					_delay_ms(500);
+					displayMessage(4,MSG_INCORRECT_PASSWORD);
+					SwTimer_delayMs(500);
 					/* No break statement to keep asking about the password */
 				}
 
 				else if(status == ERROR_MESSAGE)
 				{
-					LCD_clearScreen();
-					LCD_moveCursor(0,4);
-					LCD_displayString((uint8*)"ERROR !");
+					displayMessage(4,MSG_ERROR);
 					recievePasswordStatus();/*to wait until receive continue program status*/
 					/* to display the main menu again*/
 					break;
@@ -285,44 +288,111 @@ void UserOptions(uint8* a_first_password,uint8* a_second_password){
 
 /****************************************************************************************/
 
+/*
+ * Description : display the door state until the door is closed, meanwhile the user can extend
+ * the open time (DOOR_EXTEND_OPTION) or close the door now (DOOR_CANCEL_OPTION)
+*/
+void waitDoorCycle(void){
+	Protocol_FrameType frame;
+	uint8 key;
+	boolean key_held = FALSE;
+
+	status = DOOR_IS_OPENING;
+	displayDoorState(MSG_DOOR_OPENING);
+
+	while(status != DOOR_CLOSED)
+	{
+		/* one option per key press, not while the key is held */
+		if(KEYPAD_tryGetPressedKey(&key))
+		{
+			if(!key_held && ((key == DOOR_EXTEND_OPTION) || (key == DOOR_CANCEL_OPTION)))
+			{
+				HMI_sendOption(key);
+			}
+			key_held = TRUE;
+		}
+		else
+		{
+			key_held = FALSE;
+		}
+
+		/* the door state sent by control ECU (closing - closed) */
+		if(PROTOCOL_pollFrame(&frame) && (frame.type == PROTOCOL_MSG_STATUS) && (frame.length == 1))
+		{
+			status = frame.payload[0];
+			if(status == DOOR_IS_CLOSING)
+			{
+				displayDoorState(MSG_DOOR_CLOSING);
+			}
+		}
+
+		SwTimer_process();
+		Power_idle();
+	}
+}
+
+/****************************************************************************************/
+
+/*
+ * Description : display the door state with the keys the user can press during the door cycle
+*/
+void displayDoorState(HMI_MessageType message){
+	LCD_clearScreen();
+	LCD_displayStringRowColumn_P(0,4,(const char*)pgm_read_word(&g_messages[message]));
+	LCD_displayStringRowColumn_P(1,0,(const char*)pgm_read_word(&g_messages[MSG_DOOR_KEYS]));
+	LCD_flush();
+}
+
+/****************************************************************************************/
+
 /*
  * Description : gets the status from control ECU of the passwords  (matching or not)
 */
 uint8 recievePasswordStatus(void){
+	Protocol_FrameType frame;
 
-	/* Wait until the control ECU is ready to send the status */
-	while(UART_recieveByte()!= CONTROL_ECU_READY);
-	UART_sendByte(HMI_ECU_READY);
+	/* Wait for a status frame which carries one byte */
+	do
+	{
+		PROTOCOL_receiveMessage(PROTOCOL_MSG_STATUS,&frame);
+	}while(frame.length != 1);
 
 	/*read the status*/
-	return UART_recieveByte();
+	return frame.payload[0];
 }
 
 /*************************************************************************************/
 /*
- * Description : take the user's option (pressed key )
+ * Description : gets the provisioning state from control ECU at boot (DEVICE_PROVISIONED - DEVICE_NOT_PROVISIONED)
 */
-uint8 HMI_takeOption(void){
-	return KEYPAD_getPressedKey();
+uint8 recieveProvisioningState(void){
+	Protocol_FrameType frame;
+
+	/* Wait for the provisioning frame which carries one byte */
+	do
+	{
+		PROTOCOL_receiveMessage(PROTOCOL_MSG_PROVISIONING,&frame);
+	}while(frame.length != 1);
+
+	return frame.payload[0];
 }
 
-/***************************************************************************************/
+/*************************************************************************************/
 /*
- * Description : increment the global counter for the timer (Call Back Funcation)
+ * Description : take the user's option (pressed key )
 */
-void HMI_handleTimer(void){
-	timer_flag ++;
+uint8 HMI_takeOption(void){
+	return KEYPAD_getPressedKey();
 }
+
 /****************************************************************************************/
 /*
  * Description : sends the option which user chose from the main menu to be handled in control ECU side
 */
 void HMI_sendOption(uint8 option){
 
-	UART_sendByte(HMI_ECU_READY);
-	/* Wait until the control ECU is ready to recieve option */
-	while(UART_recieveByte()!= CONTROL_ECU_READY);
-	 UART_sendByte(option);
+	/* Send the option in one frame */
+	PROTOCOL_sendFrame(PROTOCOL_MSG_OPTION,&option,1);
 }
 
 /***************************************************************************************/
@@ -337,21 +407,33 @@ int main(void){
 	/* Contain First Password Taken From User */
 	uint8 second_password_buffer[PASSWORD_LENGTH];
 
-	/* callback function of timer1 */
-	Timer1_setCallBack(HMI_handleTimer);
-
 	/* UART configuration*/
-	UART_ConfigType s_uart_config = {Eight_bits,Disabled,one_bit,Double_Speed_mode,HMI_BAUD_RATE};
+	UART_ConfigType s_uart_config = {Eight_bits,Disabled,one_bit,Double_Speed_mode,UART_LINK_UBRR};
 	UART_init(&s_uart_config);
 
 	/* LCD Intialization */
 	LCD_init();
 
+	/* start the 1ms system tick of the software timers */
+	SwTimer_init();
+
+	/* start measuring the idle time */
+	Power_init();
+
 	/* Enable (I-bit) */
 	SREG |= (1<<7);
 
-	/* Ask User to Enter The password for first time the we check if 2 passwords are matched or not*/
-	Display_EnterPassword_AndCheckStatus(first_password_buffer,second_password_buffer);
+	/* agree with Control ECU on the link baud rate */
+	PROTOCOL_linkProbe();
+
+	/*
+	 * Ask User to Enter The password for first time the we check if 2 passwords are matched or not,
+	 * a provisioned Control ECU (password already saved) goes straight to the main menu
+	 */
+	if(recieveProvisioningState() != DEVICE_PROVISIONED)
+	{
+		Display_EnterPassword_AndCheckStatus(first_password_buffer,second_password_buffer);
+	}
 
 	/*this while loop used to keep asking the user to choose from the main menu*/
 	while(1){
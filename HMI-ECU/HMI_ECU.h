@@ -14,20 +14,36 @@
  *                                Definitions                                  *
  *******************************************************************************/
 #define PASSWORD_LENGTH 5  			/* Password Length */
-#define HMI_BAUD_RATE 9600	 		/* UART Baud Rate */
 #define OPEN_DOOR_OPTION '+'		/* Open door option */
 #define CHANGE_PASSWORD_OPTION '-'	/* Change Password Option */
+#define DOOR_EXTEND_OPTION '='		/* Keep the door open longer (during the door cycle) */
+#define DOOR_CANCEL_OPTION '*'		/* Close the door now (during the door cycle) */
+#define PASSWORD_ECHO_COLUMN 11		/* The '*' echo of the password ends on the last column of the 16 columns LCD */
 
 /********************* These defintions to sync between the 2 ECU **********************/
-#define CONTROL_ECU_READY 0x10
-#define HMI_ECU_READY 0x20
 #define PASSWORD_MATCH 0x11
 #define PASSWORD_DISMATCH 0x00
 #define ERROR_MESSAGE 0xFF
 #define DOOR_IS_OPENING 0X22
 #define DOOR_IS_CLOSING 0X33
 #define DOOR_CLOSED 0X44
+#define DOOR_IS_BUSY 0X88
+#define DEVICE_PROVISIONED 0X66
+#define DEVICE_NOT_PROVISIONED 0X77
 #define Enter_Key 13
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+/* The UI messages, their strings are in a program memory (PROGMEM) table in HMI_ECU.c */
+typedef enum
+{
+	MSG_ENTER_PASSWORD,MSG_REENTER_PASSWORD,MSG_OPEN_DOOR_MENU,MSG_CHANGE_PASSWORD_MENU,
+	MSG_CORRECT_PASSWORD,MSG_PASSWORDS_DISMATCH,MSG_ENTER_CURRENT_PASSWORD,MSG_DOOR_OPENING,
+	MSG_DOOR_CLOSING,MSG_WRONG_PASSWORD,MSG_THIEF,MSG_CHANGING_PASSWORD,MSG_INCORRECT_PASSWORD,MSG_ERROR,
+	MSG_DOOR_KEYS,MSG_DOOR_BUSY
+}HMI_MessageType;
+
 /*******************************************************************************
  *                              Functions Prototypes                           *
  *******************************************************************************/
@@ -51,6 +67,12 @@ void Display_EnterPassword(uint8* first_password,uint8* second_password);
  */
 void displayUserOptions(void);
 
+/*
+ * Description : display a one line message on a clear screen, only the cells which differ
+ * from the current screen are sent to the LCD
+ */
+void displayMessage(uint8 col,HMI_MessageType message);
+
 /*
  * Description : this function takes two passwords , check them and display status on screen
 */
@@ -61,11 +83,6 @@ void Display_EnterPassword_AndCheckStatus(uint8* a_first_password_ptr,uint8* a_s
 */
 void UserOptions(uint8* a_first_password_ptr,uint8* a_second_password_ptr);
 
-/*
- * Description : increment the global counter for the timer (Call Back Funcation)
-*/
-void HMI_handleTimer(void);
-
 /*
  * Description : sends the option which user chose from the main menu to be handled in control ECU side
 */
@@ -76,9 +93,25 @@ void HMI_sendOption(uint8 option);
 */
 uint8 HMI_takeOption(void);
 
+/*
+ * Description : display the door state until the door is closed, meanwhile the user can extend
+ * the open time (DOOR_EXTEND_OPTION) or close the door now (DOOR_CANCEL_OPTION)
+*/
+void waitDoorCycle(void);
+
+/*
+ * Description : display the door state with the keys the user can press during the door cycle
+*/
+void displayDoorState(HMI_MessageType message);
+
 /*
  * Description : gets the status from control ECU of the passwords  (matching or not)
 */
 uint8 recievePasswordStatus(void);
 
+/*
+ * Description : gets the provisioning state from control ECU at boot (DEVICE_PROVISIONED - DEVICE_NOT_PROVISIONED)
+*/
+uint8 recieveProvisioningState(void);
+
 #endif /* HMI_ECU_H_ */
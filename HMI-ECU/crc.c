@@ -0,0 +1,52 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.c
+ *
+ * Description: Source file for the CRC-8 checksum used by the ECUs
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "crc.h"
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add one byte to a running CRC-8 value and return the new CRC value.
+ */
+uint8 CRC8_update(uint8 crc,uint8 data)
+{
+	uint8 bit;
+
+	crc ^= data;
+	for(bit = 0;bit < 8;bit++)
+	{
+		if(crc & 0x80)
+			crc = (crc << 1) ^ CRC8_POLYNOMIAL;
+		else
+			crc <<= 1;
+	}
+	return crc;
+}
+
+/*
+ * Description :
+ * Calculate the CRC-8 of the required buffer.
+ */
+uint8 CRC8_calculate(const uint8 *data,uint8 length)
+{
+	uint8 crc = CRC8_INITIAL_VALUE;
+	uint8 i;
+
+	for(i = 0;i < length;i++)
+	{
+		crc = CRC8_update(crc,data[i]);
+	}
+	return crc;
+}
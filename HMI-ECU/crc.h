@@ -0,0 +1,45 @@
+ /******************************************************************************
+ *
+ * Module: CRC
+ *
+ * File Name: crc.h
+ *
+ * Description: Header file for the CRC-8 checksum used by the ECUs
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * CRC-8 polynomial x^8 + x^2 + x + 1 and its initial value, the initial value is not 0 so a zeroed record
+ * or an erased one (all 0xFF) doesn't pass the check of the saved records
+ */
+#define CRC8_POLYNOMIAL                0x07
+#define CRC8_INITIAL_VALUE             0xFF
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add one byte to a running CRC-8 value and return the new CRC value.
+ */
+uint8 CRC8_update(uint8 crc,uint8 data);
+
+/*
+ * Description :
+ * Calculate the CRC-8 of the required buffer.
+ */
+uint8 CRC8_calculate(const uint8 *data,uint8 length);
+
+#endif /* CRC_H_ */
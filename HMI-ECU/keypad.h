@@ -39,8 +39,14 @@
 
 /*
  * Description :
- * Get the Keypad pressed button
+ * Get the Keypad pressed button, it waits in idle mode until a button is pressed
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Scan the keypad once, returns TRUE and the pressed button value if a button is pressed
+ */
+boolean KEYPAD_tryGetPressedKey(uint8 *key);
+
 #endif /* KEYPAD_H_ */
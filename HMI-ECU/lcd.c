@@ -11,10 +11,111 @@
  *******************************************************************************/
 
 #include <util/delay.h> /* For the delay functions */
+#include <avr/io.h> /* To use SREG */
+#include <avr/interrupt.h> /* For cli() */
+#include <avr/pgmspace.h> /* To read the strings from the program memory */
 #include "common_macros.h" /* To use the macros like SET_BIT */
 #include "lcd.h"
 #include "gpio.h"
+#include "Timer.h" /* The queue is drained by a timer interrupt */
+#include "power.h" /* To wait in idle mode */
 //#include "stdlib.h"
+
+/*******************************************************************************
+ *                           Private Definitions                               *
+ *******************************************************************************/
+
+/*
+ * Bus timing delay, it covers every HD44780 bus timing (Tas = 40ns, PWeh = 230ns, Tdsw = 80ns,
+ * Tddr = 160ns, Th = 10ns) with some margin, the instruction time is covered by the busy flag
+ */
+#define LCD_BUS_DELAY()                _delay_us(1)
+
+/*
+ * Registers of the LCD pins, the bus functions run in the queue ISR so they access them directly
+ * instead of through the GPIO driver (the port IDs are constants, the choice is done at compile time)
+ */
+#define LCD_PORT_REG(ID)               (*(((ID) == PORTA_ID) ? &PORTA : ((ID) == PORTB_ID) ? &PORTB : ((ID) == PORTC_ID) ? &PORTC : &PORTD))
+#define LCD_DDR_REG(ID)                (*(((ID) == PORTA_ID) ? &DDRA : ((ID) == PORTB_ID) ? &DDRB : ((ID) == PORTC_ID) ? &DDRC : &DDRD))
+#define LCD_PIN_REG(ID)                (*(((ID) == PORTA_ID) ? &PINA : ((ID) == PORTB_ID) ? &PINB : ((ID) == PORTC_ID) ? &PINC : &PIND))
+
+/* Data pins of the LCD in its port */
+#if (LCD_DATA_BITS_MODE == 4)
+#define LCD_DATA_PINS_MASK             (0x0F << LCD_FIRST_DATA_PIN_ID)
+#else
+#define LCD_DATA_PINS_MASK             0xFF
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Shadow frame buffer of the screen and its dirty bitmap (one bit per cell which differs from the screen) */
+static uint8 g_frame[LCD_ROWS][LCD_COLS];
+static uint8 g_dirty[((LCD_ROWS * LCD_COLS) + 7) / 8];
+
+/* Frame buffer cursor */
+static uint8 g_cursorRow = 0;
+static uint8 g_cursorCol = 0;
+
+/* DDRAM address of the LCD address counter, it is known only after a cursor command sent by LCD_flush */
+static uint8 g_lcdAddress = 0;
+static boolean g_lcdAddressValid = FALSE;
+
+/* Bytes queued for the LCD and their type (one bit per entry, 1 for a command) */
+static uint8 g_queue[LCD_QUEUE_SIZE];
+static uint8 g_queueCommand[LCD_QUEUE_SIZE / 8];
+
+/* Free running queue indices (head: next to write - tail: next to send) */
+static volatile uint8 g_queueHead = 0;
+static volatile uint8 g_queueTail = 0;
+
+/* TRUE while the queue timer runs */
+static volatile boolean g_queueRunning = FALSE;
+
+/*
+ * Bus phase of the next queue tick, one phase per tick to keep the ISR short:
+ * FALSE to read the busy flag, TRUE to write the oldest queued byte (the LCD was found ready)
+ */
+static volatile boolean g_queueWritePhase = FALSE;
+
+/* Busy flag reads of the oldest queued byte, it is written anyway after LCD_QUEUE_BUSY_TICK_LIMIT */
+static volatile uint8 g_queueBusyTicks = 0;
+
+/* Powers of ten for the decimal fields (subtract and count, no division) */
+static const uint16 g_powersOfTen[LCD_DECIMAL_MAX_DIGITS] PROGMEM = {10000,1000,100,10,1};
+
+/* Timer2 configuration of the queue tick */
+static const Timer_ConfigType g_queueTimerConfig = TIMER_CONFIG_US(Timer2,LCD_QUEUE_TICK_US);
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+/* Read the busy flag once (RS=0 RW=1), returns TRUE while the LCD is busy */
+static boolean LCD_readBusyFlag(void);
+
+/* Poll the busy flag until the LCD is ready for the next byte */
+static void LCD_waitBusy(void);
+
+/* Write one byte on the LCD bus, rs_value = LOGIC_LOW for a command or LOGIC_HIGH for a data byte */
+static void LCD_writeByte(uint8 rs_value,uint8 value);
+
+/* Add one byte to the queue, rs_value as LCD_writeByte */
+static void LCD_enqueue(uint8 rs_value,uint8 value);
+
+/* Send the oldest queued byte (the queue must not be empty) */
+static void LCD_sendQueued(void);
+
+/* Queue timer call back function, it does one bus phase (busy flag read or byte write) per tick */
+static void LCD_queueTick(void);
+
+/* Write a frame buffer cell and mark it dirty if it changed */
+static void LCD_setCell(uint8 row,uint8 col,uint8 data);
+
+/* DDRAM address of a screen cell */
+static uint8 LCD_cellAddress(uint8 row,uint8 col);
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -24,9 +125,19 @@
  * Initialize the LCD:
  * 1. Setup the LCD pins directions by use the GPIO driver.
  * 2. Setup the LCD Data Mode 4-bits or 8-bits.
+ * 3. Clear the screen and its frame buffer.
  */
 void LCD_init(void)
 {
+	uint8 row;
+	uint8 col;
+
+	/* The queue timer is started by the first queued byte */
+	Timer2_setCallBack(LCD_queueTick);
+
+	/* The LCD needs 40ms after power on before the first command */
+	_delay_ms(LCD_POWER_ON_DELAY_MS);
+
 	/* Configure the direction for RS, RW and E pins as output pins */
 	GPIO_setupPinDirection(LCD_RS_PORT_ID,LCD_RS_PIN_ID,PIN_OUTPUT);
 	GPIO_setupPinDirection(LCD_RW_PORT_ID,LCD_RW_PIN_ID,PIN_OUTPUT);
@@ -51,190 +162,513 @@ void LCD_init(void)
 
 	LCD_sendCommand(LCD_CURSOR_OFF); /* cursor off */
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* clear LCD at the beginning */
+
+	/* The screen is blank so the frame buffer is blank and clean */
+	for(row = 0;row < LCD_ROWS;row++)
+	{
+		for(col = 0;col < LCD_COLS;col++)
+		{
+			g_frame[row][col] = ' ';
+		}
+	}
+	for(row = 0;row < sizeof(g_dirty);row++)
+	{
+		g_dirty[row] = 0;
+	}
+	g_cursorRow = 0;
+	g_cursorCol = 0;
 }
 
 /*
  * Description :
- * Send the required command to the screen
+ * Queue the required command to the screen (not through the frame buffer),
+ * the commands which change the screen content must not be used with the frame buffer
  */
 void LCD_sendCommand(uint8 command)
 {
-#if (LCD_DATA_BITS_MODE == 4)
-		uint8 lcd_port_value = 0;
-#endif
+	LCD_enqueue(LOGIC_LOW,command); /* Instruction Mode RS=0 */
 
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+	/* The command may move the LCD address counter */
+	g_lcdAddressValid = FALSE;
+}
 
-#if (LCD_DATA_BITS_MODE == 4)
-	/* out the last 4 bits of the required command to the data bus D4 --> D7 */
-	lcd_port_value = GPIO_readPort(LCD_DATA_PORT_ID);
-#ifdef LCD_LAST_PORT_PINS
-	lcd_port_value = (lcd_port_value & 0x0F) | (command & 0xF0);
-#else
-	lcd_port_value = (lcd_port_value & 0xF0) | ((command & 0xF0) >> 4);
-#endif
-	GPIO_writePort(LCD_DATA_PORT_ID,lcd_port_value);
+/*
+ * Description :
+ * Write the required character in the frame buffer at the cursor (shown by LCD_flush)
+ */
+void LCD_displayCharacter(uint8 data)
+{
+	/* The characters out of the screen are clipped */
+	if((g_cursorRow < LCD_ROWS) && (g_cursorCol < LCD_COLS))
+	{
+		LCD_setCell(g_cursorRow,g_cursorCol,data);
+		g_cursorCol++;
+	}
+}
 
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+/*
+ * Description :
+ * Write the required string in the frame buffer at the cursor (shown by LCD_flush)
+ */
+void LCD_displayString(const char *Str)
+{
+	uint8 i = 0;
+	while(Str[i] != '\0')
+	{
+		LCD_displayCharacter(Str[i]);
+		i++;
+	}
+	/***************** Another Method ***********************
+	while((*Str) != '\0')
+	{
+		LCD_displayCharacter(*Str);
+		Str++;
+	}		
+	*********************************************************/
+}
 
-	/* out the first 4 bits of the required command to the data bus D4 --> D7 */
-	lcd_port_value = GPIO_readPort(LCD_DATA_PORT_ID);
-#ifdef LCD_LAST_PORT_PINS
-	lcd_port_value = (lcd_port_value & 0x0F) | ((command & 0x0F) << 4);
-#else
-	lcd_port_value = (lcd_port_value & 0xF0) | (command & 0x0F);
-#endif
-	GPIO_writePort(LCD_DATA_PORT_ID,lcd_port_value);
+/*
+ * Description :
+ * Write the required string which is saved in the program memory (PROGMEM) in the frame buffer at the cursor
+ */
+void LCD_displayString_P(const char *Str)
+{
+	uint8 character = pgm_read_byte(Str);
 
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	while(character != '\0')
+	{
+		LCD_displayCharacter(character);
+		Str++;
+		character = pgm_read_byte(Str);
+	}
+}
 
-#elif (LCD_DATA_BITS_MODE == 8)
-	GPIO_writePort(LCD_DATA_PORT_ID,command); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-#endif
+/*
+ * Description :
+ * Move the frame buffer cursor to a specified row and column index on the screen
+ */
+void LCD_moveCursor(uint8 row,uint8 col)
+{
+	/* The LCD cursor is moved by LCD_flush only where a changed cell needs it */
+	g_cursorRow = row;
+	g_cursorCol = col;
 }
 
 /*
  * Description :
- * Display the required character on the screen
- * Same As Send_command() Function But RS = 1
+ * Write the required string in a specified row and column index in the frame buffer (shown by LCD_flush)
  */
-void LCD_displayCharacter(uint8 data)
+void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
 {
+	LCD_moveCursor(row,col); /* go to to the required LCD position */
+	LCD_displayString(Str); /* display the string */
+}
+
+/*
+ * Description :
+ * Write the required program memory (PROGMEM) string in a specified row and column index in the frame buffer
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str)
+{
+	LCD_moveCursor(row,col); /* go to to the required LCD position */
+	LCD_displayString_P(Str); /* display the string */
+}
+
+/*
+ * Description :
+ * Write the required decimal value in the frame buffer at the cursor (shown by LCD_flush)
+ */
+void LCD_intgerToString(int data)
+{
+	/* The sign then the magnitude with as many digits as it needs (no itoa, no buffer) */
+	if(data < 0)
+	{
+		LCD_displayCharacter('-');
+		LCD_displayDecimal((uint16)0 - (uint16)data,0,' ');
+	}
+	else
+	{
+		LCD_displayDecimal((uint16)data,0,' ');
+	}
+}
+
+/*
+ * Description :
+ * Write the value as a right-aligned decimal field of width characters in the frame buffer at the cursor,
+ * the field is padded on the left with pad ('0' or ' '), width = 0 for as many digits as the value needs.
+ * A value wider than the field fills it with LCD_FIELD_OVERFLOW_CHARACTER. No division is used.
+ */
+void LCD_displayDecimal(uint16 value,uint8 width,uint8 pad)
+{
+	uint8 digits = 1;
+	uint8 digit;
+	uint16 power;
+	uint8 i;
+
+	/* Number of digits of the value: compare it with the powers of ten */
+	while((digits < LCD_DECIMAL_MAX_DIGITS) &&
+		  (value >= pgm_read_word(&g_powersOfTen[LCD_DECIMAL_MAX_DIGITS - 1 - digits])))
+	{
+		digits++;
+	}
+
+	if(width == 0)
+	{
+		width = digits;
+	}
+	else if(digits > width)
+	{
+		for(i = 0;i < width;i++)
+		{
+			LCD_displayCharacter(LCD_FIELD_OVERFLOW_CHARACTER);
+		}
+		return;
+	}
+
+	for(i = digits;i < width;i++)
+	{
+		LCD_displayCharacter(pad);
+	}
+
+	/* Each digit is the number of times its power of ten can be subtracted (9 subtractions at most) */
+	for(i = LCD_DECIMAL_MAX_DIGITS - digits;i < LCD_DECIMAL_MAX_DIGITS;i++)
+	{
+		power = pgm_read_word(&g_powersOfTen[i]);
+		digit = '0';
+		while(value >= power)
+		{
+			value -= power;
+			digit++;
+		}
+		LCD_displayCharacter(digit);
+	}
+}
+
+/*
+ * Description :
+ * Write the low width digits (1 to LCD_HEX_MAX_DIGITS) of the value in upper case hex,
+ * zero padded, in the frame buffer at the cursor.
+ */
+void LCD_displayHex(uint16 value,uint8 width)
+{
+	uint8 nibble;
+
+	if(width > LCD_HEX_MAX_DIGITS)
+	{
+		width = LCD_HEX_MAX_DIGITS;
+	}
+
+	/* The most significant digit of the field first */
+	while(width > 0)
+	{
+		width--;
+		nibble = (uint8)(value >> (width * 4)) & 0x0F;
+		LCD_displayCharacter((nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10));
+	}
+}
+
+/*
+ * Description :
+ * Clear the frame buffer and move its cursor home (shown by LCD_flush, no clear command is sent)
+ */
+void LCD_clearScreen(void)
+{
+	uint8 row;
+	uint8 col;
+
+	for(row = 0;row < LCD_ROWS;row++)
+	{
+		for(col = 0;col < LCD_COLS;col++)
+		{
+			LCD_setCell(row,col,' ');
+		}
+	}
+	g_cursorRow = 0;
+	g_cursorCol = 0;
+}
+
+/*
+ * Description :
+ * Queue the frame buffer cells which changed since the last flush to the screen,
+ * every run of changed cells costs one cursor command then its characters,
+ * it returns once they are queued (it waits only if the queue is full).
+ */
+void LCD_flush(void)
+{
+	uint8 row;
+	uint8 col;
+	uint8 cell = 0;
+
+	for(row = 0;row < LCD_ROWS;row++)
+	{
+		for(col = 0;col < LCD_COLS;col++,cell++)
+		{
+			if(g_dirty[cell >> 3] & (1 << (cell & 7)))
+			{
+				/* The LCD address counter moves by one after every character, so only a run start needs a cursor command */
+				if(!g_lcdAddressValid || (g_lcdAddress != LCD_cellAddress(row,col)))
+				{
+					g_lcdAddress = LCD_cellAddress(row,col);
+					LCD_enqueue(LOGIC_LOW,g_lcdAddress | LCD_SET_CURSOR_LOCATION);
+					g_lcdAddressValid = TRUE;
+				}
+
+				LCD_enqueue(LOGIC_HIGH,g_frame[row][col]);
+				g_lcdAddress++;
+				g_dirty[cell >> 3] &= ~(1 << (cell & 7));
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Wait until the queued bytes are sent to the LCD, the CPU is in idle mode meanwhile
+ * (the queue is drained here if the global interrupt is disabled).
+ */
+void LCD_waitIdle(void)
+{
+	while(g_queueHead != g_queueTail)
+	{
+		if(SREG & (1<<7))
+		{
+			Power_idle();
+		}
+		else
+		{
+			LCD_waitBusy();
+			LCD_sendQueued();
+		}
+	}
+}
+
+/*
+ * Description :
+ * Read the busy flag once (RS=0 RW=1), returns TRUE while the LCD is busy,
+ * the data pins are inputs while the LCD drives the bus (direct register access, it runs in the queue ISR).
+ */
+static boolean LCD_readBusyFlag(void)
+{
+	boolean busy;
+
+	LCD_DDR_REG(LCD_DATA_PORT_ID) &= (uint8)~LCD_DATA_PINS_MASK; /* the LCD drives the data pins */
+	CLEAR_BIT(LCD_PORT_REG(LCD_RS_PORT_ID),LCD_RS_PIN_ID); /* Instruction Mode RS=0 */
+	SET_BIT(LCD_PORT_REG(LCD_RW_PORT_ID),LCD_RW_PIN_ID); /* read the busy flag so RW=1 */
+	LCD_BUS_DELAY(); /* delay for processing Tas = 40ns */
+	SET_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Enable LCD E=1 */
+	LCD_BUS_DELAY(); /* delay for processing Tddr = 160ns */
+	busy = BIT_IS_SET(LCD_PIN_REG(LCD_DATA_PORT_ID),LCD_BUSY_FLAG_PIN_ID) ? TRUE : FALSE; /* the busy flag is on D7 */
+	CLEAR_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Disable LCD E=0 */
+
 #if (LCD_DATA_BITS_MODE == 4)
-	uint8 lcd_port_value = 0;
+	/* the second nibble (address counter low bits) must be clocked out too */
+	LCD_BUS_DELAY();
+	SET_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Enable LCD E=1 */
+	LCD_BUS_DELAY();
+	CLEAR_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Disable LCD E=0 */
 #endif
 
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_HIGH); /* Data Mode RS=1 */
-	GPIO_writePin(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* write data to LCD so RW=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+	CLEAR_BIT(LCD_PORT_REG(LCD_RW_PORT_ID),LCD_RW_PIN_ID); /* write data to LCD so RW=0 */
+	LCD_DDR_REG(LCD_DATA_PORT_ID) |= LCD_DATA_PINS_MASK; /* the MCU drives the data pins again */
+
+	return busy;
+}
+
+/*
+ * Description :
+ * Poll the busy flag until the LCD is ready for the next byte,
+ * it gives up after LCD_BUSY_POLL_LIMIT reads so a missing LCD doesn't block the HMI ECU.
+ */
+static void LCD_waitBusy(void)
+{
+	uint16 polls = 0;
+
+	while(LCD_readBusyFlag() && (polls < LCD_BUSY_POLL_LIMIT))
+	{
+		polls++;
+	}
+}
+
+/*
+ * Description :
+ * Write one byte on the LCD bus, rs_value = LOGIC_LOW for a command or LOGIC_HIGH for a data byte,
+ * the LCD must be ready (busy flag read before), direct register access as it runs in the queue ISR.
+ */
+static void LCD_writeByte(uint8 rs_value,uint8 value)
+{
+	if(rs_value == LOGIC_LOW)
+	{
+		CLEAR_BIT(LCD_PORT_REG(LCD_RS_PORT_ID),LCD_RS_PIN_ID); /* Instruction Mode RS=0 */
+	}
+	else
+	{
+		SET_BIT(LCD_PORT_REG(LCD_RS_PORT_ID),LCD_RS_PIN_ID); /* Data Mode RS=1 */
+	}
+	CLEAR_BIT(LCD_PORT_REG(LCD_RW_PORT_ID),LCD_RW_PIN_ID); /* write data to LCD so RW=0 */
+	LCD_BUS_DELAY(); /* delay for processing Tas = 40ns */
+	SET_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Enable LCD E=1 */
 
 #if (LCD_DATA_BITS_MODE == 4)
-	/* out the last 4 bits of the required data to the data bus D4 --> D7 */
-	lcd_port_value = GPIO_readPort(LCD_DATA_PORT_ID);
+	/* out the last 4 bits of the required value to the data bus D4 --> D7 */
 #ifdef LCD_LAST_PORT_PINS
-	lcd_port_value = (lcd_port_value & 0x0F) | (data & 0xF0);
+	LCD_PORT_REG(LCD_DATA_PORT_ID) = (LCD_PORT_REG(LCD_DATA_PORT_ID) & 0x0F) | (value & 0xF0);
 #else
-	lcd_port_value = (lcd_port_value & 0xF0) | ((data & 0xF0) >> 4);
+	LCD_PORT_REG(LCD_DATA_PORT_ID) = (LCD_PORT_REG(LCD_DATA_PORT_ID) & 0xF0) | ((value & 0xF0) >> 4);
 #endif
-	GPIO_writePort(LCD_DATA_PORT_ID,lcd_port_value);
 
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+	LCD_BUS_DELAY(); /* delay for processing Tdsw = 80ns and PWeh = 230ns */
+	CLEAR_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Disable LCD E=0 */
+	LCD_BUS_DELAY(); /* delay for processing Th = 10ns and the E cycle time */
+	SET_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Enable LCD E=1 */
 
-	/* out the first 4 bits of the required data to the data bus D4 --> D7 */
-	lcd_port_value = GPIO_readPort(LCD_DATA_PORT_ID);
+	/* out the first 4 bits of the required value to the data bus D4 --> D7 */
 #ifdef LCD_LAST_PORT_PINS
-	lcd_port_value = (lcd_port_value & 0x0F) | ((data & 0x0F) << 4);
+	LCD_PORT_REG(LCD_DATA_PORT_ID) = (LCD_PORT_REG(LCD_DATA_PORT_ID) & 0x0F) | ((value & 0x0F) << 4);
 #else
-	lcd_port_value = (lcd_port_value & 0xF0) | (data & 0x0F);
+	LCD_PORT_REG(LCD_DATA_PORT_ID) = (LCD_PORT_REG(LCD_DATA_PORT_ID) & 0xF0) | (value & 0x0F);
 #endif
-	GPIO_writePort(LCD_DATA_PORT_ID,lcd_port_value);
 
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	LCD_BUS_DELAY(); /* delay for processing Tdsw = 80ns and PWeh = 230ns */
+	CLEAR_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Disable LCD E=0 */
 
 #elif (LCD_DATA_BITS_MODE == 8)
-	GPIO_writePort(LCD_DATA_PORT_ID,data); /* out the required data to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+	LCD_PORT_REG(LCD_DATA_PORT_ID) = value; /* out the required value to the data bus D0 --> D7 */
+	LCD_BUS_DELAY(); /* delay for processing Tdsw = 80ns and PWeh = 230ns */
+	CLEAR_BIT(LCD_PORT_REG(LCD_E_PORT_ID),LCD_E_PIN_ID); /* Disable LCD E=0 */
 #endif
 }
 
 /*
  * Description :
- * Display the required string on the screen
+ * Add one byte to the queue and start the queue timer if it is stopped,
+ * if the queue is full it waits for a free entry (in idle mode, the ISR frees one within LCD_QUEUE_BUSY_TICK_LIMIT ticks).
+ * Without the global interrupt (at init) the queue is drained and the byte is sent here.
  */
-void LCD_displayString(const char *Str)
+static void LCD_enqueue(uint8 rs_value,uint8 value)
 {
-	uint8 i = 0;
-	while(Str[i] != '\0')
+	uint8 sreg;
+	uint8 index;
+
+	if(!(SREG & (1<<7)))
 	{
-		LCD_displayCharacter(Str[i]);
-		i++;
+		/* Nothing drains the queue, keep the order of the queued bytes */
+		LCD_waitIdle();
+		LCD_waitBusy();
+		LCD_writeByte(rs_value,value);
+		return;
 	}
-	/***************** Another Method ***********************
-	while((*Str) != '\0')
+
+	while((uint8)(g_queueHead - g_queueTail) >= LCD_QUEUE_SIZE)
 	{
-		LCD_displayCharacter(*Str);
-		Str++;
-	}		
-	*********************************************************/
+		Power_idle();
+	}
+
+	/* The head and the timer state are shared with the queue ISR */
+	sreg = SREG;
+	cli();
+	index = g_queueHead & (LCD_QUEUE_SIZE - 1);
+	g_queue[index] = value;
+	if(rs_value == LOGIC_LOW)
+	{
+		g_queueCommand[index >> 3] |= (1 << (index & 7));
+	}
+	else
+	{
+		g_queueCommand[index >> 3] &= ~(1 << (index & 7));
+	}
+	g_queueHead++;
+
+	if(!g_queueRunning)
+	{
+		g_queueRunning = TRUE;
+		Timer_init(&g_queueTimerConfig);
+	}
+	SREG = sreg;
 }
 
 /*
  * Description :
- * Move the cursor to a specified row and column index on the screen
+ * Send the oldest queued byte (the queue must not be empty and the LCD must be ready).
  */
-void LCD_moveCursor(uint8 row,uint8 col)
+static void LCD_sendQueued(void)
 {
-	uint8 lcd_memory_address;
-	
-	/* Calculate the required address in the LCD DDRAM */
-	switch(row)
-	{
-		case 0:
-			lcd_memory_address=col;
-				break;
-		case 1:
-			lcd_memory_address=col+0x40;
-				break;
-		case 2:
-			lcd_memory_address=col+0x10;
-				break;
-		case 3:
-			lcd_memory_address=col+0x50;
-				break;
-	}					
-	/* Move the LCD cursor to this specific address */
-	LCD_sendCommand(lcd_memory_address | LCD_SET_CURSOR_LOCATION);
+	uint8 index = g_queueTail & (LCD_QUEUE_SIZE - 1);
+
+	LCD_writeByte((g_queueCommand[index >> 3] & (1 << (index & 7))) ? LOGIC_LOW : LOGIC_HIGH,g_queue[index]);
+	g_queueTail++;
+
+	/* The next byte starts with a busy flag read */
+	g_queueWritePhase = FALSE;
+	g_queueBusyTicks = 0;
 }
 
 /*
  * Description :
- * Display the required string in a specified row and column index on the screen
+ * Queue timer call back function (ISR), it does one bus phase per tick so the UART RX interrupt
+ * never waits long: the busy flag is read on a tick and the byte is written on the next one.
+ * A LCD busy for LCD_QUEUE_BUSY_TICK_LIMIT reads gets the byte anyway (as LCD_waitBusy) so a missing LCD
+ * doesn't fill the queue for ever, the timer is stopped once the queue is empty.
  */
-void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
+static void LCD_queueTick(void)
 {
-	LCD_moveCursor(row,col); /* go to to the required LCD position */
-	LCD_displayString(Str); /* display the string */
+	if(g_queueHead == g_queueTail)
+	{
+		Timer_DeInit(Timer2);
+		g_queueRunning = FALSE;
+		g_queueWritePhase = FALSE;
+		g_queueBusyTicks = 0;
+		return;
+	}
+
+	if(g_queueWritePhase)
+	{
+		LCD_sendQueued();
+	}
+	else if(!LCD_readBusyFlag())
+	{
+		g_queueWritePhase = TRUE;
+	}
+	else
+	{
+		g_queueBusyTicks++;
+		if(g_queueBusyTicks >= LCD_QUEUE_BUSY_TICK_LIMIT)
+		{
+			g_queueWritePhase = TRUE;
+		}
+	}
 }
 
 /*
  * Description :
- * Display the required decimal value on the screen
+ * Write a frame buffer cell and mark it dirty if it changed.
  */
-void LCD_intgerToString(int data)
+static void LCD_setCell(uint8 row,uint8 col,uint8 data)
 {
-   char buff[16]; /* String to hold the ascii result */
-   itoa(data,buff,10); /* Use itoa C function to convert the data to its corresponding ASCII value, 10 for decimal */
-   LCD_displayString(buff); /* Display the string */
+	uint8 cell = (row * LCD_COLS) + col;
+
+	if(g_frame[row][col] != data)
+	{
+		g_frame[row][col] = data;
+		g_dirty[cell >> 3] |= (1 << (cell & 7));
+	}
 }
 
 /*
  * Description :
- * Send the clear screen command
+ * DDRAM address of a screen cell.
  */
-void LCD_clearScreen(void)
+static uint8 LCD_cellAddress(uint8 row,uint8 col)
 {
-	LCD_sendCommand(LCD_CLEAR_COMMAND); /* Send clear display command */
+	/* Calculate the required address in the LCD DDRAM */
+	switch(row)
+	{
+		case 1:
+			return col+0x40;
+		case 2:
+			return col+LCD_COLS; /* the rows 2 and 3 continue the rows 0 and 1 in the DDRAM */
+		case 3:
+			return col+0x40+LCD_COLS;
+		default:
+			return col;
+	}
 }
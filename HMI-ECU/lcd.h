@@ -38,6 +38,19 @@
 
 #endif
 
+/*
+ * LCD size, the screen content is kept in a shadow frame buffer of this size,
+ * the text written out of the screen is clipped
+ */
+#define LCD_ROWS                       2
+#define LCD_COLS                       16
+
+#if((LCD_ROWS < 1) || (LCD_ROWS > 4) || (LCD_COLS < 1) || (LCD_COLS > 20))
+
+#error "LCD size should be up to 4 rows and 20 columns"
+
+#endif
+
 /* LCD HW Ports and Pins Ids */
 #define LCD_RS_PORT_ID                 PORTD_ID
 #define LCD_RS_PIN_ID                  PIN4_ID
@@ -50,6 +63,52 @@
 
 #define LCD_DATA_PORT_ID               PORTB_ID
 
+/* Busy flag (D7) pin, it is read with RS=0 and RW=1 before every write */
+#if (LCD_DATA_BITS_MODE == 4)
+#define LCD_BUSY_FLAG_PIN_ID           (LCD_FIRST_DATA_PIN_ID + 3)
+#else
+#define LCD_BUSY_FLAG_PIN_ID           PIN7_ID
+#endif
+
+/*
+ * Max busy flag reads before writing anyway on the synchronous path (each read is a few us, longer than
+ * the 1.52ms clear command), so a missing LCD doesn't block the HMI ECU (see LCD_QUEUE_BUSY_TICK_LIMIT for the queue)
+ */
+#define LCD_BUSY_POLL_LIMIT            1000
+
+/* Wait after power on before the first command (the busy flag can't be read before) */
+#define LCD_POWER_ON_DELAY_MS          40
+
+/*
+ * The bytes sent to the LCD go through a queue which is drained in the background by the Timer2
+ * compare interrupt, one byte every two LCD_QUEUE_TICK_US if the LCD is not busy (the timer runs only
+ * while the queue is not empty). The queue size should be a power of two.
+ */
+#define LCD_QUEUE_SIZE                 64
+#define LCD_QUEUE_TICK_US              100
+
+/*
+ * Every tick does one bus phase: a busy flag read then the byte write on the next tick,
+ * the byte is written anyway after LCD_QUEUE_BUSY_TICK_LIMIT busy reads (4ms, longer than the 1.52ms clear command)
+ * so a missing LCD doesn't block the HMI ECU on a full queue.
+ */
+#define LCD_QUEUE_BUSY_TICK_LIMIT      40
+
+/* Number fields: max decimal digits of a uint16, the character shown in a field too small for its value */
+#define LCD_DECIMAL_MAX_DIGITS         5
+#define LCD_HEX_MAX_DIGITS             4
+#define LCD_FIELD_OVERFLOW_CHARACTER   '*'
+
+#if((LCD_QUEUE_SIZE < 8) || (LCD_QUEUE_SIZE > 128) || (LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)))
+
+#error "LCD queue size should be a power of two between 8 and 128"
+
+#elif((LCD_QUEUE_BUSY_TICK_LIMIT < 1) || (LCD_QUEUE_BUSY_TICK_LIMIT > 255))
+
+#error "LCD queue busy tick limit should be between 1 and 255"
+
+#endif
+
 /* LCD Commands */
 #define LCD_CLEAR_COMMAND              0x01
 #define LCD_GO_TO_HOME                 0x02
@@ -68,49 +127,93 @@
  * Initialize the LCD:
  * 1. Setup the LCD pins directions by use the GPIO driver.
  * 2. Setup the LCD Data Mode 4-bits or 8-bits.
+ * 3. Clear the screen and its frame buffer.
  */
 void LCD_init(void);
 
 /*
  * Description :
- * Send the required command to the screen
+ * Queue the required command to the screen (not through the frame buffer),
+ * the commands which change the screen content must not be used with the frame buffer
  */
 void LCD_sendCommand(uint8 command);
 
 /*
  * Description :
- * Display the required character on the screen
+ * Write the required character in the frame buffer at the cursor (shown by LCD_flush)
  */
 void LCD_displayCharacter(uint8 data);
 
 /*
  * Description :
- * Display the required string on the screen
+ * Write the required string in the frame buffer at the cursor (shown by LCD_flush)
  */
 void LCD_displayString(const char *Str);
 
 /*
  * Description :
- * Move the cursor to a specified row and column index on the screen
+ * Write the required string which is saved in the program memory (PROGMEM) in the frame buffer at the cursor
+ */
+void LCD_displayString_P(const char *Str);
+
+/*
+ * Description :
+ * Move the frame buffer cursor to a specified row and column index on the screen
  */
 void LCD_moveCursor(uint8 row,uint8 col);
 
 /*
  * Description :
- * Display the required string in a specified row and column index on the screen
+ * Write the required string in a specified row and column index in the frame buffer (shown by LCD_flush)
  */
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 
 /*
  * Description :
- * Display the required decimal value on the screen
+ * Write the required program memory (PROGMEM) string in a specified row and column index in the frame buffer
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
+/*
+ * Description :
+ * Write the required decimal value in the frame buffer at the cursor (shown by LCD_flush)
  */
 void LCD_intgerToString(int data);
 
 /*
  * Description :
- * Send the clear screen command
+ * Write the value as a right-aligned decimal field of width characters in the frame buffer at the cursor,
+ * the field is padded on the left with pad ('0' or ' '), width = 0 for as many digits as the value needs.
+ * A value wider than the field fills it with LCD_FIELD_OVERFLOW_CHARACTER. No division is used.
+ */
+void LCD_displayDecimal(uint16 value,uint8 width,uint8 pad);
+
+/*
+ * Description :
+ * Write the low width digits (1 to LCD_HEX_MAX_DIGITS) of the value in upper case hex,
+ * zero padded, in the frame buffer at the cursor.
+ */
+void LCD_displayHex(uint16 value,uint8 width);
+
+/*
+ * Description :
+ * Clear the frame buffer and move its cursor home (shown by LCD_flush, no clear command is sent)
  */
 void LCD_clearScreen(void);
 
+/*
+ * Description :
+ * Queue the frame buffer cells which changed since the last flush to the screen,
+ * every run of changed cells costs one cursor command then its characters,
+ * it returns once they are queued (it waits only if the queue is full).
+ */
+void LCD_flush(void);
+
+/*
+ * Description :
+ * Wait until the queued bytes are sent to the LCD, the CPU is in idle mode meanwhile
+ * (the queue is drained here if the global interrupt is disabled).
+ */
+void LCD_waitIdle(void);
+
 #endif /* LCD_H_ */
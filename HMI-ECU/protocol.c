@@ -0,0 +1,280 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.c
+ *
+ * Description: Source file for the framed UART protocol between the HMI ECU and the Control ECU
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#include "protocol.h"
+#include "crc.h"
+#include "uart.h"
+#include "sw_timer.h"
+#include "power.h"
+
+/*
+ * The receiver sleeps between the bytes only if UART buffers them from its RX interrupt,
+ * in polling mode a sleeping CPU would lose them.
+ */
+#if(UART_DRIVER_MODE == UART_INTERRUPT)
+#define PROTOCOL_WAIT_BYTES()          Power_idle()
+#else
+#define PROTOCOL_WAIT_BYTES()
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Frame decoder of the UART link */
+static Protocol_ParserType g_linkParser = {PROTOCOL_WAIT_SOF};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the frame decoder to wait for a new SOF.
+ */
+void PROTOCOL_initParser(Protocol_ParserType *parser)
+{
+	parser->state = PROTOCOL_WAIT_SOF;
+	parser->index = 0;
+	parser->crc = CRC8_INITIAL_VALUE;
+}
+
+/*
+ * Description :
+ * Feed one received byte to the frame decoder.
+ * Returns TRUE when the byte completes a frame with a valid CRC (the frame is in parser->frame),
+ * frames with a wrong CRC or length are dropped and the decoder waits for the next SOF.
+ */
+boolean PROTOCOL_parseByte(Protocol_ParserType *parser,uint8 data)
+{
+	switch(parser->state)
+	{
+		case PROTOCOL_WAIT_SOF:
+			if(data == PROTOCOL_SOF)
+			{
+				parser->crc = CRC8_INITIAL_VALUE;
+				parser->state = PROTOCOL_WAIT_TYPE;
+			}
+			break;
+
+		case PROTOCOL_WAIT_TYPE:
+			parser->frame.type = data;
+			parser->crc = CRC8_update(parser->crc,data);
+			parser->state = PROTOCOL_WAIT_LENGTH;
+			break;
+
+		case PROTOCOL_WAIT_LENGTH:
+			if(data > PROTOCOL_MAX_PAYLOAD_LENGTH)
+			{
+				/* Not a valid frame, resynchronize on the next SOF */
+				parser->state = PROTOCOL_WAIT_SOF;
+				break;
+			}
+			parser->frame.length = data;
+			parser->crc = CRC8_update(parser->crc,data);
+			parser->index = 0;
+			parser->state = (data == 0) ? PROTOCOL_WAIT_CRC : PROTOCOL_WAIT_PAYLOAD;
+			break;
+
+		case PROTOCOL_WAIT_PAYLOAD:
+			parser->frame.payload[parser->index] = data;
+			parser->crc = CRC8_update(parser->crc,data);
+			parser->index++;
+			if(parser->index == parser->frame.length)
+			{
+				parser->state = PROTOCOL_WAIT_CRC;
+			}
+			break;
+
+		case PROTOCOL_WAIT_CRC:
+			parser->state = PROTOCOL_WAIT_SOF;
+			if(data == parser->crc)
+			{
+				return TRUE;
+			}
+			break;
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Encode the required message in one frame and send the whole frame through UART as one burst.
+ */
+void PROTOCOL_sendFrame(uint8 type,const uint8 *payload,uint8 length)
+{
+	uint8 buffer[PROTOCOL_MAX_PAYLOAD_LENGTH + PROTOCOL_FRAME_OVERHEAD];
+	uint8 i;
+
+	if(length > PROTOCOL_MAX_PAYLOAD_LENGTH)
+	{
+		return;
+	}
+
+	buffer[0] = PROTOCOL_SOF;
+	buffer[1] = type;
+	buffer[2] = length;
+	for(i = 0;i < length;i++)
+	{
+		buffer[3 + i] = payload[i];
+	}
+
+	/* The CRC covers everything after the SOF */
+	buffer[3 + length] = CRC8_calculate(&buffer[1],length + 2);
+
+	UART_sendBuffer(buffer,length + PROTOCOL_FRAME_OVERHEAD);
+}
+
+/*
+ * Description :
+ * Wait until a complete valid frame is received through UART,
+ * the software timers keep running while waiting.
+ */
+void PROTOCOL_receiveFrame(Protocol_FrameType *frame)
+{
+	while(!PROTOCOL_pollFrame(frame))
+	{
+		SwTimer_process();
+		PROTOCOL_WAIT_BYTES();
+	}
+}
+
+/*
+ * Description :
+ * Wait until a complete valid frame with the required message type is received,
+ * frames of any other type are dropped.
+ */
+void PROTOCOL_receiveMessage(uint8 type,Protocol_FrameType *frame)
+{
+	do
+	{
+		PROTOCOL_receiveFrame(frame);
+	}while(frame->type != type);
+}
+
+/*
+ * Description :
+ * Non-blocking receive, it decodes the bytes already received by UART and returns TRUE
+ * once a complete valid frame is decoded.
+ */
+boolean PROTOCOL_pollFrame(Protocol_FrameType *frame)
+{
+	uint8 data;
+
+	while(UART_tryReceive(&data))
+	{
+		if(PROTOCOL_parseByte(&g_linkParser,data))
+		{
+			*frame = g_linkParser.frame;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Wait up to timeout_ms (measured by the uptime clock) for a valid frame with the required
+ * message type, returns FALSE if no such frame is received in time.
+ */
+boolean PROTOCOL_waitMessage(uint8 type,Protocol_FrameType *frame,uint16 timeout_ms)
+{
+	uint32 deadline = Clock_nowMs() + timeout_ms;
+
+	do
+	{
+		if(PROTOCOL_pollFrame(frame) && (frame->type == type))
+		{
+			return TRUE;
+		}
+		SwTimer_process();
+		PROTOCOL_WAIT_BYTES();
+	}while(!CLOCK_IS_REACHED(Clock_nowMs(),deadline));
+
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Link speed probe on the HMI ECU side, it returns once the Control ECU answers
+ * at UART_LINK_BAUD_RATE or at UART_SAFE_BAUD_RATE.
+ */
+void PROTOCOL_linkProbe(void)
+{
+	Protocol_FrameType frame;
+	uint16 ubrr_value = UART_LINK_UBRR;
+	uint8 retries;
+
+	/*
+	 * Try the high link baud rate first then the safe one, in turn until the Control ECU answers:
+	 * a Control ECU which is busy (alarm) when the HMI ECU resets alone keeps its rate and answers later
+	 */
+	while(1)
+	{
+		for(retries = 0;retries < PROTOCOL_PROBE_RETRIES;retries++)
+		{
+			PROTOCOL_sendFrame(PROTOCOL_MSG_LINK_PROBE,NULL_PTR,0);
+			if(PROTOCOL_waitMessage(PROTOCOL_MSG_LINK_ACK,&frame,PROTOCOL_PROBE_PERIOD_MS))
+			{
+				return;
+			}
+		}
+
+		/* No answer at this rate, try the other one */
+		ubrr_value = (ubrr_value == UART_LINK_UBRR) ? UART_SAFE_UBRR : UART_LINK_UBRR;
+		UART_changeBaudRate(ubrr_value);
+		PROTOCOL_initParser(&g_linkParser);
+	}
+}
+
+/*
+ * Description :
+ * Link speed probe on the Control ECU side, it returns once the probe of the HMI ECU
+ * is answered at UART_LINK_BAUD_RATE or at UART_SAFE_BAUD_RATE.
+ */
+void PROTOCOL_linkAnswer(void)
+{
+	Protocol_FrameType frame;
+	uint32 deadline = Clock_nowMs() + PROTOCOL_PROBE_WINDOW_MS;
+
+	/*
+	 * Listen at the high link baud rate first, the window is not closed in the middle of a frame
+	 * so a probe which arrives at its end is still answered at this rate
+	 */
+	do
+	{
+		if(PROTOCOL_pollFrame(&frame) && (frame.type == PROTOCOL_MSG_LINK_PROBE))
+		{
+			PROTOCOL_answerLinkProbe();
+			return;
+		}
+		SwTimer_process();
+		PROTOCOL_WAIT_BYTES();
+	}while(!CLOCK_IS_REACHED(Clock_nowMs(),deadline) || (g_linkParser.state != PROTOCOL_WAIT_SOF));
+
+	/* No probe, fall back to the safe baud rate and wait for the HMI ECU there */
+	UART_changeBaudRate(UART_SAFE_UBRR);
+	PROTOCOL_initParser(&g_linkParser);
+	PROTOCOL_receiveMessage(PROTOCOL_MSG_LINK_PROBE,&frame);
+
+	PROTOCOL_answerLinkProbe();
+}
+
+/*
+ * Description :
+ * Answer a link speed probe at the current baud rate (the rate the probe arrived on),
+ * the Control ECU calls it for every probe received after the boot.
+ */
+void PROTOCOL_answerLinkProbe(void)
+{
+	PROTOCOL_sendFrame(PROTOCOL_MSG_LINK_ACK,NULL_PTR,0);
+}
@@ -0,0 +1,155 @@
+ /******************************************************************************
+ *
+ * Module: Protocol
+ *
+ * File Name: protocol.h
+ *
+ * Description: Header file for the framed UART protocol between the HMI ECU and the Control ECU
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Frame format:
+ * | SOF | Message Type | Length | Payload (Length bytes) | CRC-8 |
+ * The CRC-8 covers the message type, the length and the payload.
+ */
+#define PROTOCOL_SOF                   0x7E
+#define PROTOCOL_MAX_PAYLOAD_LENGTH    24
+#define PROTOCOL_FRAME_OVERHEAD        4    /* SOF + Type + Length + CRC */
+
+/* Message Types */
+#define PROTOCOL_MSG_STATUS            0x01 /* Control ECU --> HMI ECU : one status byte */
+#define PROTOCOL_MSG_CREDENTIAL        0x02 /* HMI ECU --> Control ECU : the whole entered password */
+#define PROTOCOL_MSG_OPTION            0x03 /* HMI ECU --> Control ECU : the selected option */
+#define PROTOCOL_MSG_LINK_PROBE        0x04 /* HMI ECU --> Control ECU : link speed probe at boot */
+#define PROTOCOL_MSG_LINK_ACK          0x05 /* Control ECU --> HMI ECU : link speed probe answer */
+#define PROTOCOL_MSG_PROVISIONING      0x06 /* Control ECU --> HMI ECU : provisioning state at boot (one byte) */
+#define PROTOCOL_MSG_ADMIN             0x07 /* Admin tool <--> Control ECU : add/revoke a user, answered by one status byte */
+#define PROTOCOL_MSG_DIAG              0x08 /* Admin tool <--> Control ECU : empty request, answered by the power and link statistics */
+
+/*
+ * Link speed probe at boot:
+ * The HMI ECU sends a probe at UART_LINK_BAUD_RATE every PROTOCOL_PROBE_PERIOD_MS up to PROTOCOL_PROBE_RETRIES times,
+ * the Control ECU listens at UART_LINK_BAUD_RATE for PROTOCOL_PROBE_WINDOW_MS.
+ * If they don't hear each other both of them fall back to UART_SAFE_BAUD_RATE and wait for each other,
+ * the HMI probing time is longer than the Control window so the two ECUs always end at the same rate.
+ * The Control window is not closed while a frame is being received, so a probe at the end of the window is answered.
+ * After the boot the Control ECU answers every probe at the rate it is on (see PROTOCOL_answerLinkProbe),
+ * so an HMI ECU which resets alone finds it again at the high rate or after its fall back to the safe rate.
+ */
+#define PROTOCOL_PROBE_PERIOD_MS       20
+#define PROTOCOL_PROBE_RETRIES         50
+#define PROTOCOL_PROBE_WINDOW_MS       500
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/* States of the frame decoder */
+typedef enum
+{
+	PROTOCOL_WAIT_SOF,PROTOCOL_WAIT_TYPE,PROTOCOL_WAIT_LENGTH,PROTOCOL_WAIT_PAYLOAD,PROTOCOL_WAIT_CRC
+}Protocol_ParserState;
+
+/* Decoded frame */
+typedef struct
+{
+	uint8 type;
+	uint8 length;
+	uint8 payload[PROTOCOL_MAX_PAYLOAD_LENGTH];
+}Protocol_FrameType;
+
+/* Frame decoder which is fed byte by byte */
+typedef struct
+{
+	Protocol_ParserState state;
+	uint8 index;
+	uint8 crc;
+	Protocol_FrameType frame;
+}Protocol_ParserType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the frame decoder to wait for a new SOF.
+ */
+void PROTOCOL_initParser(Protocol_ParserType *parser);
+
+/*
+ * Description :
+ * Feed one received byte to the frame decoder.
+ * Returns TRUE when the byte completes a frame with a valid CRC (the frame is in parser->frame),
+ * frames with a wrong CRC or length are dropped and the decoder waits for the next SOF.
+ */
+boolean PROTOCOL_parseByte(Protocol_ParserType *parser,uint8 data);
+
+/*
+ * Description :
+ * Encode the required message in one frame and send the whole frame through UART as one burst.
+ */
+void PROTOCOL_sendFrame(uint8 type,const uint8 *payload,uint8 length);
+
+/*
+ * Description :
+ * Wait until a complete valid frame is received through UART,
+ * the software timers keep running while waiting.
+ */
+void PROTOCOL_receiveFrame(Protocol_FrameType *frame);
+
+/*
+ * Description :
+ * Wait until a complete valid frame with the required message type is received,
+ * frames of any other type are dropped.
+ */
+void PROTOCOL_receiveMessage(uint8 type,Protocol_FrameType *frame);
+
+/*
+ * Description :
+ * Non-blocking receive, it decodes the bytes already received by UART and returns TRUE
+ * once a complete valid frame is decoded.
+ */
+boolean PROTOCOL_pollFrame(Protocol_FrameType *frame);
+
+/*
+ * Description :
+ * Wait up to timeout_ms (measured by the uptime clock) for a valid frame with the required
+ * message type, returns FALSE if no such frame is received in time.
+ */
+boolean PROTOCOL_waitMessage(uint8 type,Protocol_FrameType *frame,uint16 timeout_ms);
+
+/*
+ * Description :
+ * Link speed probe on the HMI ECU side, it probes at UART_LINK_BAUD_RATE and UART_SAFE_BAUD_RATE
+ * in turn and returns once the Control ECU answers.
+ */
+void PROTOCOL_linkProbe(void);
+
+/*
+ * Description :
+ * Link speed probe on the Control ECU side, it returns once the probe of the HMI ECU
+ * is answered at UART_LINK_BAUD_RATE or at UART_SAFE_BAUD_RATE.
+ */
+void PROTOCOL_linkAnswer(void);
+
+/*
+ * Description :
+ * Answer a link speed probe at the current baud rate (the rate the probe arrived on),
+ * the Control ECU calls it for every probe received after the boot.
+ */
+void PROTOCOL_answerLinkProbe(void);
+
+#endif /* PROTOCOL_H_ */
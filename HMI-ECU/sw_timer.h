@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * Module: Software Timers
+ *
+ * File Name: sw_timer.h
+ *
+ * Description: Header file for the software timers (hashed timer wheel) driven by a 1ms Timer1 tick
+ *
+ * Author: Kareem Mohamed
+ *
+ *******************************************************************************/
+
+#ifndef SW_TIMER_H_
+#define SW_TIMER_H_
+
+#include "std_types.h"
+#include "Timer.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* The wheel is advanced by the tick of the uptime clock (Timer1, see Clock_init in Timer.h) */
+#define SWTIMER_TICK_MS                CLOCK_TICK_MS
+
+/*
+ * Number of slots in the timer wheel, it should be a power of two,
+ * a timer which expires at tick T is hashed to slot T % SWTIMER_WHEEL_SIZE
+ */
+#define SWTIMER_WHEEL_SIZE             32
+
+#if((SWTIMER_WHEEL_SIZE < 2) || (SWTIMER_WHEEL_SIZE > 128) || (SWTIMER_WHEEL_SIZE & (SWTIMER_WHEEL_SIZE - 1)))
+
+#error "Timer wheel size should be a power of two between 2 and 128"
+
+#endif
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+
+/*
+ * Call back function of a software timer, it is called from SwTimer_process (not from the ISR),
+ * it must not block: SwTimer_process is not reentrant so no timer expires until it returns
+ * and SwTimer_delayMs refuses to wait (it returns FALSE) when it is called from a call back function.
+ */
+typedef void (*SwTimer_CallBackType)(void *context);
+
+/*
+ * Software timer, the application owns its memory and the wheel only links it:
+ * 1- The links to the other timers in the same wheel slot
+ * 2- The wheel slot and the tick at which the timer expires
+ * 3- The period in ms (0 for one-shot timers)
+ * 4- The call back function and its context pointer
+ */
+typedef struct SwTimer
+{
+	struct SwTimer *next;
+	struct SwTimer *prev;
+	uint8 slot;
+	boolean active;
+	uint32 expiry;
+	uint32 period_ms;
+	SwTimer_CallBackType callBack;
+	void *context;
+}SwTimer_Type;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the timer wheel and start the uptime clock which gives its 1ms tick.
+ */
+void SwTimer_init(void);
+
+/*
+ * Description :
+ * Start (or restart) a software timer which expires after delay_ms then every period_ms,
+ * period_ms = 0 for a one-shot timer. Insertion is O(1).
+ */
+void SwTimer_start(SwTimer_Type *timer,uint32 delay_ms,uint32 period_ms,SwTimer_CallBackType a_ptr,void *context);
+
+/*
+ * Description :
+ * Stop a software timer, it does nothing if the timer is not running. Removal is O(1).
+ */
+void SwTimer_stop(SwTimer_Type *timer);
+
+/*
+ * Description :
+ * Return TRUE while the software timer is running.
+ */
+boolean SwTimer_isActive(const SwTimer_Type *timer);
+
+/*
+ * Description :
+ * Return the ms left before the software timer expires (0 if it is not running).
+ */
+uint32 SwTimer_remainingMs(const SwTimer_Type *timer);
+
+/*
+ * Description :
+ * Advance the wheel by the ticks elapsed since the last call and call the call back
+ * functions of the expired timers, it must be called from the main loop and from the busy waits.
+ */
+void SwTimer_process(void);
+
+/*
+ * Description :
+ * Wait the required ms while the other software timers keep running, the CPU is in idle mode between the ticks,
+ * returns TRUE once the delay is done or FALSE without waiting if it is called from a call back function
+ * (see SwTimer_CallBackType), the delay didn't happen then.
+ */
+boolean SwTimer_delayMs(uint32 delay_ms);
+
+#endif /* SW_TIMER_H_ */
@@ -13,6 +13,105 @@
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
 #include "common_macros.h" /* To use the macros like SET_BIT */
+#include <avr/interrupt.h> /* For UART ISRs */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+#define UART_RX_BUFFER_MASK (UART_RX_BUFFER_SIZE - 1)
+#define UART_TX_BUFFER_MASK (UART_TX_BUFFER_SIZE - 1)
+
+/*
+ * Clear TXC flag (by writing one to it) keeping U2X and MPCM, it is done before each UDR write
+ * so TXC is set only after the last written byte leaves the shift register
+ */
+#define UART_CLEAR_TXC() (g_txStarted = TRUE, UCSRA = (UCSRA & ((1<<U2X) | (1<<MPCM))) | (1<<TXC))
+
+/* The UDRE ISR can't run while the I-bit is clear (before sei, inside an ISR or a cli section) */
+#define UART_INTERRUPTS_MASKED() BIT_IS_CLEAR(SREG,7)
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+/* RX ring buffer, the head is moved by the RXC ISR and the tail by the application */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;
+static volatile uint8 g_rxTail = 0;
+
+/* TX ring buffer, the head is moved by the application and the tail by the UDRE ISR */
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0;
+static volatile uint8 g_txTail = 0;
+#endif
+
+/* TXC is valid only after the first byte is written in UDR */
+static volatile boolean g_txStarted = FALSE;
+
+/* Number of received bytes lost and number of bytes rejected because the buffers were full */
+static volatile uint16 g_rxOverflowCount = 0;
+static volatile uint16 g_txOverflowCount = 0;
+
+/*******************************************************************************
+ *                      Functions Prototypes(Private)                          *
+ *******************************************************************************/
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+/* Write one byte in UDR once it is empty (polling) */
+static void UART_sendPolled(uint8 data);
+
+/* Send the queued TX bytes by polling, used while the I-bit is clear */
+static void UART_drainTxPolled(void);
+#endif
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+
+/******************************* ISR For UART Receive Complete *********************************/
+ISR(USART_RXC_vect)
+{
+	/* UCSRA must be read before UDR as reading UDR clears the error flags */
+	uint8 status = UCSRA;
+	uint8 data = UDR;
+	uint8 next_head = (g_rxHead + 1) & UART_RX_BUFFER_MASK;
+
+	/* Data OverRun: a byte was lost in the hardware before this ISR could run */
+	if(BIT_IS_SET(status,DOR))
+	{
+		g_rxOverflowCount++;
+	}
+
+	if(next_head == g_rxTail)
+	{
+		/* RX buffer is full, drop the new byte */
+		g_rxOverflowCount++;
+	}
+	else
+	{
+		g_rxBuffer[g_rxHead] = data;
+		g_rxHead = next_head;
+	}
+}
+
+/******************************* ISR For UART Data Register Empty ******************************/
+ISR(USART_UDRE_vect)
+{
+	if(g_txHead != g_txTail)
+	{
+		/* Put the oldest queued byte in UDR */
+		UART_CLEAR_TXC();
+		UDR = g_txBuffer[g_txTail];
+		g_txTail = (g_txTail + 1) & UART_TX_BUFFER_MASK;
+	}
+	else
+	{
+		/* Nothing to send, disable the UDRE interrupt until a new byte is queued */
+		CLEAR_BIT(UCSRB,UDRIE);
+	}
+}
+
+#endif
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -28,16 +127,15 @@
  */
 void UART_init(const UART_ConfigType* UART_Config)
 {
-	uint16 ubrr_value = 0;
-
 	/*
 	 * U2X = 0 for Normal transmission speed
 	 * U2X = 1 for double transmission speed
 	*/
-	UCSRA = (UCSRA & 0xFD) |((UART_Config-> Operating_mode) << U2X);
+	UCSRA = (UCSRA & 0xFD) |((UART_Config->Operating_mode) << U2X);
 
 	/************************** UCSRB Description **************************
-	 * Disable all interrupts as we will use polling
+	 * In polling mode disable all interrupts
+	 * In interrupt mode RXCIE = 1 and UDRIE is set only while the TX buffer has data
 	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
 	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
@@ -48,6 +146,13 @@ void UART_init(const UART_ConfigType* UART_Config)
 	 * RXB8 & TXB8 used for 9-bit data mode
 	 ***********************************************************************/ 
 	UCSRB = (1<<RXEN) | (1<<TXEN) | (UCSRB & 0xFB) | ( ((UART_Config->data) & 0x04));
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	/* Start with empty ring buffers then enable the RX Complete Interrupt */
+	g_rxHead = g_rxTail = 0;
+	g_txHead = g_txTail = 0;
+	SET_BIT(UCSRB,RXCIE);
+#endif
 	
 	/************************** UCSRC Description **************************
 	 * URSEL   = 1 The URSEL must be one when writing the UCSRC
@@ -61,16 +166,45 @@ void UART_init(const UART_ConfigType* UART_Config)
 			|( ((UART_Config->data) & 0x03) <<1);
 	
 
-	/* Calculate the UBRR register value based on UART Operating mode*/
-	if(UART_Config->Operating_mode == Double_Speed_mode)
-		ubrr_value = (uint16)(((F_CPU / ((UART_Config->baud_rate) * 8UL))) - 1);
+	/*
+	 * The UBRR value is calculated at compile time based on UART Operating mode
+	 * First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH
+	 */
+	UBRRH = (UART_Config->ubrr_value)>>8;
+	UBRRL = UART_Config->ubrr_value;
+}
 
+/*
+ * Description :
+ * Change the UART baud rate (same Operating Mode) after the pending TX bytes are sent,
+ * the bytes received at the old baud rate are discarded.
+ */
+void UART_changeBaudRate(uint16 ubrr_value)
+{
+	uint8 data;
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	if(UART_INTERRUPTS_MASKED())
+	{
+		/* The UDRE ISR can't run, send the queued bytes here */
+		UART_drainTxPolled();
+	}
 	else
-		ubrr_value = (uint16)(((F_CPU / ((UART_Config->baud_rate) * 16UL))) - 1);
+	{
+		/* Wait until the UDRE ISR empties the TX buffer */
+		while(g_txHead != g_txTail){}
+	}
+#endif
+
+	/* Wait until the last byte leaves UDR and the shift register */
+	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
+	while(g_txStarted && BIT_IS_CLEAR(UCSRA,TXC)){}
 
-	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
 	UBRRH = ubrr_value>>8;
 	UBRRL = ubrr_value;
+
+	/* Drop what was received at the old baud rate */
+	while(UART_tryReceive(&data)){}
 }
 
 /*
@@ -79,6 +213,26 @@ void UART_init(const UART_ConfigType* UART_Config)
  */
 void UART_sendByte(const uint16 data)
 {
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	uint8 next_head = (g_txHead + 1) & UART_TX_BUFFER_MASK;
+
+	if(UART_INTERRUPTS_MASKED())
+	{
+		/* The UDRE ISR can't run, send the queued bytes then this one by polling (same order) */
+		UART_drainTxPolled();
+		UART_sendPolled((uint8)data);
+		return;
+	}
+
+	/* Wait until the UDRE ISR makes a room in the TX buffer */
+	while(next_head == g_txTail){}
+
+	g_txBuffer[g_txHead] = (uint8)data;
+	g_txHead = next_head;
+
+	/* The UDRE ISR will send it as soon as UDR is empty */
+	SET_BIT(UCSRB,UDRIE);
+#else
 	/*
 	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
 	 * transmitting a new byte so wait until this flag is set to one
@@ -89,6 +243,7 @@ void UART_sendByte(const uint16 data)
 	 * Put the required data in the UDR register and it also clear the UDRE flag as
 	 * the UDR register is not empty now
 	 */
+	UART_CLEAR_TXC();
 	if((data >> 8) == 0) /* No of data bits = 8 or less*/
 		UDR = data;
 
@@ -97,6 +252,7 @@ void UART_sendByte(const uint16 data)
 		UCSRB = ((data &0x001) << TXB8); /*Assign LSB to TXB8 (ninth bit) */
 		UDR = (data >> 1); /* Put The MS 8-bits in UDR Register */
 	}
+#endif
 }
 
 /*
@@ -105,6 +261,14 @@ void UART_sendByte(const uint16 data)
  */
 uint8 UART_recieveByte(void)
 {
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	uint8 data;
+
+	/* Wait until the RXC ISR puts a byte in the RX buffer */
+	while(!UART_tryReceive(&data)){}
+
+	return data;
+#else
 	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
 	while(BIT_IS_CLEAR(UCSRA,RXC)){}
 
@@ -113,6 +277,7 @@ uint8 UART_recieveByte(void)
 	 * The RXC flag will be cleared after read the data
 	 */
 	return UDR;
+#endif
 }
 
 /*
@@ -159,3 +324,196 @@ void UART_receiveString(uint8 *Str)
 	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
 	Str[i] = '\0';
 }
+
+/*
+ * Description :
+ * Send the required buffer through UART, in interrupt mode the whole buffer is queued
+ * in the TX buffer as one burst and the function returns once the last byte is queued.
+ */
+void UART_sendBuffer(const uint8 *data,uint8 length)
+{
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	uint8 next_head;
+
+	if(UART_INTERRUPTS_MASKED())
+	{
+		/* The UDRE ISR can't run, send the queued bytes then the buffer by polling (same order) */
+		UART_drainTxPolled();
+		while(length != 0)
+		{
+			UART_sendPolled(*data);
+			data++;
+			length--;
+		}
+		return;
+	}
+
+	while(length != 0)
+	{
+		next_head = (g_txHead + 1) & UART_TX_BUFFER_MASK;
+
+		/* Wait until the UDRE ISR makes a room in the TX buffer */
+		while(next_head == g_txTail)
+		{
+			SET_BIT(UCSRB,UDRIE);
+		}
+
+		g_txBuffer[g_txHead] = *data;
+		g_txHead = next_head;
+		data++;
+		length--;
+	}
+
+	SET_BIT(UCSRB,UDRIE);
+#else
+	while(length != 0)
+	{
+		UART_sendByte(*data);
+		data++;
+		length--;
+	}
+#endif
+}
+
+/*
+ * Description :
+ * Receive the required number of bytes through UART into the buffer.
+ */
+void UART_receiveBuffer(uint8 *data,uint8 length)
+{
+	while(length != 0)
+	{
+		*data = UART_recieveByte();
+		data++;
+		length--;
+	}
+}
+
+/*
+ * Description :
+ * Non-blocking receive, it returns TRUE and puts the oldest received byte in data if there is one
+ * or returns FALSE immediately if nothing is received yet.
+ */
+boolean UART_tryReceive(uint8 *data)
+{
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	if(g_rxHead == g_rxTail)
+	{
+		return FALSE;
+	}
+
+	*data = g_rxBuffer[g_rxTail];
+	g_rxTail = (g_rxTail + 1) & UART_RX_BUFFER_MASK;
+	return TRUE;
+#else
+	if(BIT_IS_CLEAR(UCSRA,RXC))
+	{
+		return FALSE;
+	}
+
+	/* Count the bytes lost in the hardware while nobody was reading UDR */
+	if(BIT_IS_SET(UCSRA,DOR))
+	{
+		g_rxOverflowCount++;
+	}
+
+	*data = UDR;
+	return TRUE;
+#endif
+}
+
+/*
+ * Description :
+ * Non-blocking send, it queues as many bytes as the TX buffer can take from the required data
+ * and returns the number of queued bytes, the rest of the bytes are counted as TX overflow.
+ */
+uint8 UART_write(const uint8 *data,uint8 length)
+{
+	uint8 count = 0;
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+	uint8 next_head;
+
+	while(count < length)
+	{
+		next_head = (g_txHead + 1) & UART_TX_BUFFER_MASK;
+		if(next_head == g_txTail)
+		{
+			/* TX buffer is full */
+			break;
+		}
+		g_txBuffer[g_txHead] = data[count];
+		g_txHead = next_head;
+		count++;
+	}
+
+	if(count != 0)
+	{
+		SET_BIT(UCSRB,UDRIE);
+	}
+#else
+	/* Without a TX buffer only UDR can take a byte without waiting */
+	if((length != 0) && BIT_IS_SET(UCSRA,UDRE))
+	{
+		UART_CLEAR_TXC();
+		UDR = data[0];
+		count = 1;
+	}
+#endif
+
+	g_txOverflowCount += (length - count);
+	return count;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes lost because the RX buffer (or UDR) was full.
+ */
+uint16 UART_getRxOverflowCount(void)
+{
+	uint16 count;
+
+	/* 16-bit variable shared with the RXC ISR so read it with the interrupts masked */
+	uint8 sreg = SREG;
+	cli();
+	count = g_rxOverflowCount;
+	SREG = sreg;
+
+	return count;
+}
+
+/*
+ * Description :
+ * Return the number of bytes rejected by UART_write because the TX buffer was full.
+ */
+uint16 UART_getTxOverflowCount(void)
+{
+	return g_txOverflowCount;
+}
+
+#if (UART_DRIVER_MODE == UART_INTERRUPT)
+/*
+ * Description :
+ * Write one byte in UDR once it is empty (polling).
+ */
+static void UART_sendPolled(uint8 data)
+{
+	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
+	UART_CLEAR_TXC();
+	UDR = data;
+}
+
+/*
+ * Description :
+ * Send the queued TX bytes by polling, used while the I-bit is clear
+ * (a set UDRIE is cleared by the UDRE ISR once the I-bit is set and the buffer is empty).
+ */
+static void UART_drainTxPolled(void)
+{
+	while(g_txHead != g_txTail)
+	{
+		UART_sendPolled(g_txBuffer[g_txTail]);
+		g_txTail = (g_txTail + 1) & UART_TX_BUFFER_MASK;
+	}
+}
+#endif
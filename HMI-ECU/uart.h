@@ -15,6 +15,99 @@
 
 #include "std_types.h"
 
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* UART driver modes */
+#define UART_POLLING                   0
+#define UART_INTERRUPT                 1
+
+/*
+ * UART driver mode configuration, its value should be UART_POLLING or UART_INTERRUPT
+ * UART_INTERRUPT moves the bytes through RX/TX ring buffers from the USART_RXC/USART_UDRE ISRs
+ * (8-bit frames only), the application must set the I-bit to use it,
+ * UART_sendByte, UART_sendBuffer and UART_changeBaudRate write UDR by polling while the I-bit is clear
+ */
+#define UART_DRIVER_MODE               UART_INTERRUPT
+
+#if((UART_DRIVER_MODE != UART_POLLING) && (UART_DRIVER_MODE != UART_INTERRUPT))
+
+#error "UART driver mode should be UART_POLLING or UART_INTERRUPT"
+
+#endif
+
+/* Ring buffers sizes in bytes, each of them should be a power of two (2 --> 128) */
+#define UART_RX_BUFFER_SIZE            32
+#define UART_TX_BUFFER_SIZE            32
+
+#if((UART_RX_BUFFER_SIZE < 2) || (UART_RX_BUFFER_SIZE > 128) || (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)))
+
+#error "UART RX buffer size should be a power of two between 2 and 128"
+
+#endif
+
+#if((UART_TX_BUFFER_SIZE < 2) || (UART_TX_BUFFER_SIZE > 128) || (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)))
+
+#error "UART TX buffer size should be a power of two between 2 and 128"
+
+#endif
+
+#ifndef F_CPU
+#error "F_CPU should be defined to calculate the UART baud rate"
+#endif
+
+/*
+ * UBRR value for the required baud rate rounded to the nearest integer,
+ * Normal speed mode: BAUD = F_CPU / (16 * (UBRR + 1))
+ * Double speed mode: BAUD = F_CPU / (8 * (UBRR + 1))
+ * No casts so they can be used in #if checks
+ */
+#define UART_UBRR_NORMAL(BAUD)         (((F_CPU) + 8UL * (BAUD)) / (16UL * (BAUD)) - 1UL)
+#define UART_UBRR_DOUBLE(BAUD)         (((F_CPU) + 4UL * (BAUD)) / (8UL * (BAUD)) - 1UL)
+
+/* Real baud rate generated by the rounded UBRR value */
+#define UART_ACTUAL_BAUD_NORMAL(BAUD)  ((F_CPU) / (16UL * (UART_UBRR_NORMAL(BAUD) + 1UL)))
+#define UART_ACTUAL_BAUD_DOUBLE(BAUD)  ((F_CPU) / (8UL * (UART_UBRR_DOUBLE(BAUD) + 1UL)))
+
+/* Difference between the real and the required baud rate in 0.1% units */
+#define UART_BAUD_ERROR(ACTUAL,BAUD)   ((((ACTUAL) > (BAUD)) ? ((ACTUAL) - (BAUD)) : ((BAUD) - (ACTUAL))) * 1000UL / (BAUD))
+#define UART_BAUD_ERROR_NORMAL(BAUD)   UART_BAUD_ERROR(UART_ACTUAL_BAUD_NORMAL(BAUD),(BAUD))
+#define UART_BAUD_ERROR_DOUBLE(BAUD)   UART_BAUD_ERROR(UART_ACTUAL_BAUD_DOUBLE(BAUD),(BAUD))
+
+/* Maximum accepted baud rate error in 0.1% units (2.0%) */
+#define UART_MAX_BAUD_ERROR            20
+
+/*
+ * ECU link baud rate configuration (Double speed mode U2X = 1):
+ * UART_LINK_BAUD_RATE is used at boot, its value should be from 38400 to 250000
+ * UART_SAFE_BAUD_RATE is used if the other ECU doesn't answer at UART_LINK_BAUD_RATE
+ */
+#define UART_LINK_BAUD_RATE            250000UL
+#define UART_SAFE_BAUD_RATE            9600UL
+
+#if((UART_LINK_BAUD_RATE < 38400UL) || (UART_LINK_BAUD_RATE > 250000UL))
+
+#error "UART link baud rate should be from 38400 to 250000"
+
+#endif
+
+#if(UART_BAUD_ERROR_DOUBLE(UART_LINK_BAUD_RATE) > UART_MAX_BAUD_ERROR)
+
+#error "UART link baud rate error is too high for this F_CPU"
+
+#endif
+
+#if(UART_BAUD_ERROR_DOUBLE(UART_SAFE_BAUD_RATE) > UART_MAX_BAUD_ERROR)
+
+#error "UART safe baud rate error is too high for this F_CPU"
+
+#endif
+
+/* UBRR values of the ECU link calculated at compile time */
+#define UART_LINK_UBRR                 ((uint16)UART_UBRR_DOUBLE(UART_LINK_BAUD_RATE))
+#define UART_SAFE_UBRR                 ((uint16)UART_UBRR_DOUBLE(UART_SAFE_BAUD_RATE))
+
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
@@ -54,7 +147,7 @@ typedef enum
  ** Enable Parity bit (Odd or Even) or Disable Parity bit
  ** number of stop bits of UART Frame
  ** UART Operating Mode
- ** Baud rate Of UART
+ ** UBRR value of the required baud rate (use UART_UBRR_NORMAL or UART_UBRR_DOUBLE)
 */
 typedef struct
 {
@@ -62,7 +155,7 @@ typedef struct
 	Parity_Type Parity_bit;
 	no_of_stop_bits stop_bit;
 	UART_OperatingMode Operating_mode;
-	uint32 baud_rate;
+	uint16 ubrr_value;
 }UART_ConfigType;
 
 
@@ -80,6 +173,13 @@ typedef struct
  */
 void UART_init(const UART_ConfigType* UART_Config);
 
+/*
+ * Description :
+ * Change the UART baud rate (same Operating Mode) after the pending TX bytes are sent,
+ * the bytes received at the old baud rate are discarded.
+ */
+void UART_changeBaudRate(uint16 ubrr_value);
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
@@ -104,4 +204,43 @@ void UART_sendString(const uint8 *Str);
  */
 void UART_receiveString(uint8 *Str); // Receive until #
 
+/*
+ * Description :
+ * Send the required buffer through UART, in interrupt mode the whole buffer is queued
+ * in the TX buffer as one burst and the function returns once the last byte is queued.
+ */
+void UART_sendBuffer(const uint8 *data,uint8 length);
+
+/*
+ * Description :
+ * Receive the required number of bytes through UART into the buffer.
+ */
+void UART_receiveBuffer(uint8 *data,uint8 length);
+
+/*
+ * Description :
+ * Non-blocking receive, it returns TRUE and puts the oldest received byte in data if there is one
+ * or returns FALSE immediately if nothing is received yet.
+ */
+boolean UART_tryReceive(uint8 *data);
+
+/*
+ * Description :
+ * Non-blocking send, it queues as many bytes as the TX buffer can take from the required data
+ * and returns the number of queued bytes, the rest of the bytes are counted as TX overflow.
+ */
+uint8 UART_write(const uint8 *data,uint8 length);
+
+/*
+ * Description :
+ * Return the number of received bytes lost because the RX buffer (or UDR) was full.
+ */
+uint16 UART_getRxOverflowCount(void);
+
+/*
+ * Description :
+ * Return the number of bytes rejected by UART_write because the TX buffer was full.
+ */
+uint16 UART_getTxOverflowCount(void);
+
 #endif /* UART_H_ */